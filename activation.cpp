@@ -0,0 +1,188 @@
+#include "activation.h"
+#include "kernels.h"
+#include <cmath>
+
+namespace
+{
+	const double leakySlope = 0.01;
+
+	/** The value of every activation function and its derivative, expressed by the output of the function.
+	*/
+	template<activation function>
+	struct activation_traits;
+
+	template<>
+	struct activation_traits<activation::tanh>
+	{
+		template<typename scalar>
+		static scalar derivative(scalar y) { return 1 - y * y; }
+	};
+
+	template<>
+	struct activation_traits<activation::logistic>
+	{
+		template<typename scalar>
+		static scalar value(scalar x) { return 1 / (1 + std::exp(-x)); }
+		template<typename scalar>
+		static scalar derivative(scalar y) { return y * (1 - y); }
+	};
+
+	template<>
+	struct activation_traits<activation::relu>
+	{
+		template<typename scalar>
+		static scalar value(scalar x) { return x > 0 ? x : scalar(0); }
+		template<typename scalar>
+		static scalar derivative(scalar y) { return y > 0 ? scalar(1) : scalar(0); }
+	};
+
+	template<>
+	struct activation_traits<activation::leaky_relu>
+	{
+		template<typename scalar>
+		static scalar value(scalar x) { return x > 0 ? x : scalar(leakySlope) * x; }
+		template<typename scalar>
+		static scalar derivative(scalar y) { return y > 0 ? scalar(1) : scalar(leakySlope); }
+	};
+
+	template<>
+	struct activation_traits<activation::linear>
+	{
+		template<typename scalar>
+		static scalar value(scalar x) { return x; }
+		template<typename scalar>
+		static scalar derivative(scalar) { return 1; }
+	};
+
+	template<activation function, typename scalar>
+	void transform(scalar* values, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			values[i] = activation_traits<function>::value(values[i]);
+	}
+
+	template<activation function, typename scalar>
+	void multiply(const scalar* outputs, scalar* gradients, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			gradients[i] *= activation_traits<function>::derivative(outputs[i]);
+	}
+
+	template<typename scalar>
+	void softmax(scalar* values, size_t n)
+	{
+		scalar largest = values[0], sum = 0;
+		for (size_t i = 1; i < n; ++i)
+			largest = values[i] > largest ? values[i] : largest;
+		for (size_t i = 0; i < n; ++i)
+		{
+			values[i] = std::exp(values[i] - largest);
+			sum += values[i];
+		}
+		for (size_t i = 0; i < n; ++i)
+			values[i] /= sum;
+	}
+
+	/** Multiplies the gradients by the Jacobian of softmax, which is diag(y) - y y^T.
+	*/
+	template<typename scalar>
+	void multiplySoftmax(const scalar* outputs, scalar* gradients, size_t n)
+	{
+		scalar weighted = 0;
+		for (size_t i = 0; i < n; ++i)
+			weighted += gradients[i] * outputs[i];
+		for (size_t i = 0; i < n; ++i)
+			gradients[i] = outputs[i] * (gradients[i] - weighted);
+	}
+
+	const char* const activationNames[] = { "tanh", "logistic", "relu", "leaky_relu", "linear", "softmax" };
+}
+
+/** Returns the name of the activation function, as used in the files.
+*/
+const char* activationName(activation function)
+{
+	return activationNames[size_t(function)];
+}
+
+/** Looks for the activation function with the name given.
+* @param name the name of the function
+* @param function the variable to which the function shall be written
+* @return false if there is no function with such name
+*/
+bool parseActivation(const std::string& name, activation& function)
+{
+	for (size_t f = 0; f < sizeof(activationNames) / sizeof(activationNames[0]); ++f)
+		if (name == activationNames[f])
+		{
+			function = activation(f);
+			return true;
+		}
+	return false;
+}
+
+/** Replaces the values of a layer with the outputs of the activation function.
+* The function is chosen once for the whole row, so that the loops are free of branches.
+* @param function the activation function
+* @param values pointer to the n values
+*/
+template<typename scalar>
+void activate(activation function, scalar* values, size_t n)
+{
+	switch (function)
+	{
+	case activation::tanh:
+		applyTanh(values, n);
+		break;
+	case activation::logistic:
+		transform<activation::logistic>(values, n);
+		break;
+	case activation::relu:
+		transform<activation::relu>(values, n);
+		break;
+	case activation::leaky_relu:
+		transform<activation::leaky_relu>(values, n);
+		break;
+	case activation::linear:
+		break;
+	case activation::softmax:
+		if (n != 0)
+			softmax(values, n);
+		break;
+	}
+}
+
+/** Multiplies the gradients with respect to the outputs of a layer by the derivative of the activation function.
+* @param function the activation function
+* @param outputs pointer to the n outputs of the function
+* @param gradients pointer to the n gradients
+*/
+template<typename scalar>
+void multiplyDerivative(activation function, const scalar* outputs, scalar* gradients, size_t n)
+{
+	switch (function)
+	{
+	case activation::tanh:
+		multiply<activation::tanh>(outputs, gradients, n);
+		break;
+	case activation::logistic:
+		multiply<activation::logistic>(outputs, gradients, n);
+		break;
+	case activation::relu:
+		multiply<activation::relu>(outputs, gradients, n);
+		break;
+	case activation::leaky_relu:
+		multiply<activation::leaky_relu>(outputs, gradients, n);
+		break;
+	case activation::linear:
+		break;
+	case activation::softmax:
+		multiplySoftmax(outputs, gradients, n);
+		break;
+	}
+}
+
+template void activate<float>(activation, float*, size_t);
+template void activate<double>(activation, double*, size_t);
+template void multiplyDerivative<float>(activation, const float*, float*, size_t);
+template void multiplyDerivative<double>(activation, const double*, double*, size_t);
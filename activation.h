@@ -0,0 +1,17 @@
+/**@file*/
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+/** The activation functions of the layers. Softmax may be used only by the output layer.
+*/
+enum class activation { tanh, logistic, relu, leaky_relu, linear, softmax };
+
+const char* activationName(activation function);
+bool parseActivation(const std::string& name, activation& function);
+
+template<typename scalar>
+void activate(activation function, scalar* values, size_t n);
+template<typename scalar>
+void multiplyDerivative(activation function, const scalar* outputs, scalar* gradients, size_t n);
@@ -0,0 +1,252 @@
+/**@file
+* The benchmarks of the network, built as a separate program from all the sources except main.cpp, interface.cpp and server.cpp,
+* e.g. g++ -std=c++17 -O2 -pthread -I.. benchmark.cpp $(find .. -maxdepth 1 -name "*.cpp" | grep -v "main\|interface\|server") -o benchmark
+* Usage: benchmark [output_path] [quick]
+* The results are written as JSON to output_path ("benchmark.json" by default); "quick" runs the smaller layouts only.
+*/
+
+#include "../compiled.h"
+#include "../kernels.h"
+#include "../threads.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
+
+namespace
+{
+	/** The number of times every measurement is repeated; the shortest time is reported.
+	*/
+	const size_t repeats = 3;
+
+	/** The number of weights multiplied in a trained epoch is kept about this high, so that wide layouts get fewer records.
+	*/
+	const double workPerEpoch = 2e8;
+
+	struct benchmark_layout
+	{
+		std::string name;
+		std::vector<size_t> layout;
+	};
+
+	const std::vector<benchmark_layout> layouts = {
+		{ "tiny", { 2, 3, 1 } },
+		{ "small", { 16, 64, 32, 4 } },
+		{ "medium", { 128, 512, 512, 10 } },
+		{ "wide", { 1024, 4096, 256 } }
+	};
+
+	const std::vector<size_t> batchSizes = { 1, 32, 256 };
+
+	double seconds(const std::function<void()>& task)
+	{
+		double best = 0.0;
+		for (size_t r = 0; r < repeats; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			task();
+			double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = r == 0 ? time : std::min(best, time);
+		}
+		return best;
+	}
+
+	double random() { return rand() / double(RAND_MAX) * 2.0 - 1.0; }
+
+	/** Times the task once for every record of the set and returns the median and the 99th percentile of the times.
+	*/
+	std::pair<double, double> latencies(size_t recordsNumber, const std::function<void(size_t)>& task)
+	{
+		std::vector<double> times(recordsNumber);
+		for (size_t r = 0; r < recordsNumber; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			task(r);
+			times[r] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		std::sort(times.begin(), times.end());
+		return { times[times.size() / 2], times[times.size() * 99 / 100] };
+	}
+
+	/** Writes a set of random records in the .set format.
+	* @return the size of the file in bytes
+	*/
+	size_t writeSet(const std::string& path, size_t inputsNumber, size_t outputsNumber, size_t recordsNumber)
+	{
+		std::ofstream file(path, std::ios::out | std::ios::binary);
+		file << inputsNumber << ' ' << outputsNumber << '\n';
+		for (size_t r = 0; r < recordsNumber; ++r)
+		{
+			for (size_t i = 0; i < inputsNumber + outputsNumber; ++i)
+				file << random() << ' ';
+			file << '\n';
+		}
+		return size_t(file.tellp());
+	}
+
+	size_t weightsNumber(const std::vector<size_t>& layout)
+	{
+		size_t total = 0;
+		for (size_t l = 1; l < layout.size(); ++l)
+			total += layout[l] * (layout[l - 1] + 1);
+		return total;
+	}
+
+	/** Collects the results as JSON objects.
+	*/
+	class result_list
+	{
+		std::vector<std::string> results;
+	public:
+		void add(const benchmark_layout& layout, const std::string& measurement, size_t batchSize,
+			double time, size_t records, double bytes = 0.0)
+		{
+			std::ostringstream result;
+			result << "{\"layout\": \"" << layout.name << "\", \"sizes\": [";
+			for (size_t l = 0; l < layout.layout.size(); ++l)
+				result << (l == 0 ? "" : ", ") << layout.layout[l];
+			result << "], \"measurement\": \"" << measurement << "\", \"batch_size\": " << batchSize
+				<< ", \"records\": " << records << ", \"seconds\": " << time;
+			if (records != 0)
+				result << ", \"records_per_second\": " << records / time
+					<< ", \"microseconds_per_record\": " << time * 1e6 / records;
+			if (bytes != 0.0)
+				result << ", \"megabytes_per_second\": " << bytes / time / 1e6;
+			result << "}";
+			results.push_back(result.str());
+			std::cerr << results.back() << std::endl;
+		}
+		void addLatency(const benchmark_layout& layout, const std::string& measurement, std::pair<double, double> times)
+		{
+			std::ostringstream result;
+			result << "{\"layout\": \"" << layout.name << "\", \"measurement\": \"" << measurement
+				<< "\", \"p50_microseconds\": " << times.first * 1e6 << ", \"p99_microseconds\": " << times.second * 1e6 << "}";
+			results.push_back(result.str());
+			std::cerr << results.back() << std::endl;
+		}
+		void write(std::ostream& output) const
+		{
+			output << "{\n\"instruction_set\": \"" << instructionSetName(currentInstructionSet())
+				<< "\",\n\"threads\": " << defaultThreadsNumber() << ",\n\"results\": [\n";
+			for (size_t r = 0; r < results.size(); ++r)
+				output << "  " << results[r] << (r + 1 < results.size() ? ",\n" : "\n");
+			output << "]\n}\n";
+		}
+	};
+
+	void benchmark(const benchmark_layout& layout, result_list& results)
+	{
+		const std::vector<size_t>& sizes = layout.layout;
+		size_t recordsNumber = std::max<size_t>(64, std::min<size_t>(20000, size_t(workPerEpoch / weightsNumber(sizes))));
+		std::string setPath = "benchmark_" + layout.name + ".set";
+		size_t bytes = 0;
+		double time = seconds([&]() { bytes = writeSet(setPath, sizes.front(), sizes.back(), recordsNumber); });
+		myDataSet set;
+		time = seconds([&]() { set = myDataSet(setPath); });
+		results.add(layout, "set_read", 0, time, recordsNumber, double(bytes));
+		// The same file read through the stream extraction of readRecords, without a producer thread, for comparison.
+		size_t recordsStreamed = 0;
+		time = seconds([&]() {
+			myDataStream stream(setPath, 4096, 1 << 20, 0);
+			recordsStreamed = 0;
+			while (const myDataSet* chunk = stream.next())
+				recordsStreamed += chunk->size();
+		});
+		results.add(layout, "set_read_stream", 0, time, recordsStreamed, double(bytes));
+
+		srand(1);
+		myNetwork network(sizes);
+		std::vector<double> outputs(network.outputSize());
+		time = seconds([&]() {
+			for (size_t r = 0; r < set.size(); ++r)
+				network.infer(set.inputs(r), set.inputSize(), outputs.data());
+		});
+		results.add(layout, "propagate", 1, time, set.size());
+		results.addLatency(layout, "propagate_latency", latencies(set.size(), [&](size_t r) {
+			network.infer(set.inputs(r), set.inputSize(), outputs.data());
+		}));
+
+		myCompiledNetwork compiled(network);
+		time = seconds([&]() {
+			for (size_t r = 0; r < set.size(); ++r)
+				compiled.infer(set.inputs(r), set.inputSize(), outputs.data());
+		});
+		results.add(layout, "compiled_propagate", 1, time, set.size());
+		results.addLatency(layout, "compiled_latency", latencies(set.size(), [&](size_t r) {
+			compiled.infer(set.inputs(r), set.inputSize(), outputs.data());
+		}));
+
+		time = seconds([&]() {
+			for (size_t r = 0; r < set.size(); ++r)
+			{
+				network.propagate(set.inputs(r));
+				network.backpropagate(set.targets(r));
+			}
+		});
+		results.add(layout, "propagate_backpropagate", 1, time, set.size());
+
+		for (size_t batchSize : batchSizes)
+		{
+			time = seconds([&]() { network.trainSet(set, batchSize); });
+			results.add(layout, "train_epoch", batchSize, time, set.size());
+		}
+
+		std::vector<double> predictions(set.size() * network.outputSize());
+		for (size_t batchSize : batchSizes)
+		{
+			time = seconds([&]() { network.predictBatch(set, predictions.data(), batchSize); });
+			results.add(layout, "predict_batch", batchSize, time, set.size());
+		}
+
+		time = seconds([&]() { network.testSet(set); });
+		results.add(layout, "test_set", 1, time, set.size());
+
+		for (const char* type : { ".net", ".netb" })
+		{
+			std::string networkPath = "benchmark_" + layout.name + type;
+			double fileSize = 0.0;
+			time = seconds([&]() {
+				if (std::string(type) == ".net")
+					network.saveNetwork(networkPath);
+				else
+					network.saveBinary(networkPath);
+			});
+			std::ifstream saved(networkPath, std::ios::in | std::ios::binary | std::ios::ate);
+			fileSize = double(saved.tellg());
+			saved.close();
+			results.add(layout, std::string("network_save") + type, 0, time, 0, fileSize);
+			myNetwork copy;
+			time = seconds([&]() { copy.clear(); copy.read(networkPath); });
+			results.add(layout, std::string("network_read") + type, 0, time, 0, fileSize);
+			copy.clear();
+			std::remove(networkPath.c_str());
+		}
+		std::remove(setPath.c_str());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string outputPath = argc > 1 ? argv[1] : "benchmark.json";
+	bool quick = argc > 2 and std::string(argv[2]) == "quick";
+	result_list results;
+	for (const auto& layout : layouts)
+		if (not quick or weightsNumber(layout.layout) < 100000)
+			benchmark(layout, results);
+	std::ofstream output(outputPath, std::ios::out);
+	if (not output.good())
+	{
+		std::cerr << "The results cannot be written to \"" << outputPath << "\"." << std::endl;
+		return 1;
+	}
+	results.write(output);
+	return 0;
+}
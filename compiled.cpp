@@ -0,0 +1,86 @@
+#include "compiled.h"
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+
+/** Compiles the network, copying its weights.
+* @param network the network to be compiled
+*/
+template<typename scalar>
+void myBasicCompiledNetwork<scalar>::compile(const myBasicNetwork<scalar>& network)
+{
+	const auto& source = network.layers();
+	layers.clear();
+	parameters.clear();
+	size_t total = 0, width = 0;
+	for (size_t l = 1; l < source.size(); ++l)
+		total += source[l].weightsNumber();
+	parameters.reserve(total);
+	for (size_t l = 1; l < source.size(); ++l)
+	{
+		compiled_layer layer;
+		layer.neuronsNumber = source[l].size() - 1;
+		layer.inputsNumber = source[l].inputs() - 1;
+		layer.function = source[l].getActivation();
+		const scalar* weights = source[l].weightValues();
+		layer.weightsOffset = parameters.size();
+		for (size_t i = 0; i < layer.inputsNumber; ++i)
+			for (size_t n = 0; n < layer.neuronsNumber; ++n)
+				parameters.push_back(weights[n * (layer.inputsNumber + 1) + i]);
+		layer.biasesOffset = parameters.size();
+		for (size_t n = 0; n < layer.neuronsNumber; ++n)
+			parameters.push_back(weights[n * (layer.inputsNumber + 1) + layer.inputsNumber]);
+		width = std::max(width, layer.neuronsNumber);
+		layers.push_back(layer);
+	}
+	buffers[0].assign(width, scalar(0));
+	buffers[1].assign(width, scalar(0));
+}
+
+/** Computes the outputs for the inputs. No memory is allocated.
+* @param inputs pointer to the input values
+* @param size the number of the input values
+* @param outputs pointer to the buffer of outputSize() values to which the outputs shall be written
+*/
+template<typename scalar>
+void myBasicCompiledNetwork<scalar>::infer(const scalar* inputs, size_t size, scalar* outputs)
+{
+	if (layers.empty() or size != inputSize())
+		throw incompatible_vectors();
+	const scalar* values = inputs;
+	for (size_t l = 0; l < layers.size(); ++l)
+	{
+		const compiled_layer& layer = layers[l];
+		scalar* results = l + 1 < layers.size() ? buffers[l % 2].data() : outputs;
+		affine(layer.neuronsNumber, layer.inputsNumber, values, &parameters[layer.weightsOffset],
+			&parameters[layer.biasesOffset], results);
+		activate(layer.function, results, layer.neuronsNumber);
+		values = results;
+	}
+}
+
+/** Tests the network on the data set.
+* @param set the set on which the network shall be tested
+* @return the root mean square error, computed as by myNetwork::testSet
+*/
+template<typename scalar>
+double myBasicCompiledNetwork<scalar>::testSet(const myBasicDataSet<scalar>& set)
+{
+	if (set.empty())
+		throw empty_set();
+	if (set.inputSize() != inputSize() or set.outputSize() != outputSize())
+		throw incompatible_vectors();
+	std::vector<scalar> outputs(outputSize());
+	double error = 0.0;
+	for (size_t r = 0; r < set.size(); ++r)
+	{
+		infer(set.inputs(r), inputSize(), outputs.data());
+		const scalar* targets = set.targets(r);
+		for (size_t i = 0; i < outputs.size(); ++i)
+			error += (double(outputs[i]) - targets[i]) * (double(outputs[i]) - targets[i]);
+	}
+	return sqrt(error / set.size() / set.outputSize());
+}
+
+template class myBasicCompiledNetwork<float>;
+template class myBasicCompiledNetwork<double>;
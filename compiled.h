@@ -0,0 +1,47 @@
+/**@file*/
+
+#pragma once
+#include "network.h"
+#include <vector>
+
+/** A layer of the compiled network. Its weights and biases are kept at the given offsets of the
+* parameters of the network. The weights are transposed, input by input, so that the outputs of the
+* neurons are accumulated side by side in vector registers.
+*/
+struct compiled_layer
+{
+	size_t neuronsNumber, inputsNumber;
+	activation function;
+	size_t weightsOffset, biasesOffset;
+};
+
+/** A network compiled from a trained one for inference only. All the parameters lie in one block
+* of memory, layer after layer, with the biases apart from the weights, so that no input is
+* multiplied by the constant output of a bias. Every layer is computed in one pass: the product
+* of its weights and inputs, the biases and the activation function, after which the outputs become
+* the inputs of the next layer. Two buffers preallocated for the widest layer are used in turn, and
+* the last layer is written straight to the outputs. The compiled network does not follow later
+* changes of the original one.
+*/
+template<typename scalar>
+class myBasicCompiledNetwork
+{
+	std::vector<compiled_layer> layers;
+	std::vector<scalar> parameters;
+	std::vector<scalar> buffers[2];
+
+public:
+	myBasicCompiledNetwork() {}
+	myBasicCompiledNetwork(const myBasicNetwork<scalar>& network) { compile(network); }
+
+	void compile(const myBasicNetwork<scalar>& network);
+	void infer(const scalar* inputs, size_t size, scalar* outputs);
+	double testSet(const myBasicDataSet<scalar>& set);
+
+	bool empty() const { return layers.empty(); }
+	void clear() { layers.clear(); parameters.clear(); }
+	size_t inputSize() const { return (layers.empty() ? 0 : layers.front().inputsNumber); }
+	size_t outputSize() const { return (layers.empty() ? 0 : layers.back().neuronsNumber); }
+};
+
+using myCompiledNetwork = myBasicCompiledNetwork<double>;
@@ -1,9 +1,54 @@
 #include "interface.h"
+#include "kernels.h"
+#include "quantized.h"
+#include "server.h"
+#include "statistics.h"
+#include "threads.h"
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
-#include <list>
+#include <memory>
 #include <sstream>
 #include <string>
 
+namespace
+{
+	/** Gives the message of the exception being handled. The exceptions of the networks hide
+	* std::exception::what with their own, so they are caught by their types.
+	*/
+	std::string currentErrorMessage()
+	{
+		try
+		{
+			throw;
+		}
+		catch (no_file& exc) { return exc.what(); }
+		catch (incorrect_contents& exc) { return exc.what(); }
+		catch (incomplete_contents& exc) { return exc.what(); }
+		catch (bad_path& exc) { return exc.what(); }
+		catch (bad_extension& exc) { return exc.what(); }
+		catch (incompatible_vectors& exc) { return exc.what(); }
+		catch (empty_set& exc) { return exc.what(); }
+		catch (out_of_range& exc) { return exc.what(); }
+		catch (std::exception& exc) { return exc.what(); }
+	}
+
+	/** Skips the spaces and tabs of std::cin and tells whether the line goes on with another argument.
+	*/
+	bool argumentFollows()
+	{
+		while (std::cin.peek() == ' ' or std::cin.peek() == '\t' or std::cin.peek() == '\r')
+			std::cin.get();
+		return std::cin.peek() != '\n' and std::cin.peek() != std::char_traits<char>::eof();
+	}
+}
+
+myInterface::myInterface() {}
+
+/** Destructor; stops the server, if it runs, before the networks are released.
+*/
+myInterface::~myInterface() {}
+
 /** Reads a string delimited with quotation marks from std::cin.
 * @param sentence the reference to the std::string variable which the string of characters should be written to
 */
@@ -28,22 +73,52 @@ void myInterface::readUniqueName(std::string& name)
 	bool occurred;
 	do {
 		std::cin >> name;
-		occurred = false;
-		for (const auto& n : allNetworks)
-			if (name == n.name)
-			{
-				occurred = true;
-				break;
-			}
+		occurred = allNetworks.contains(name);
 		if (occurred)
 			std::cout << "A network with such name already exists. Enter a unique name: ";
 	} while (occurred);
 }
 
+/** Adds the network to the registry under its name, unless another network has taken the name in the meantime.
+* @return whether the network has been added
+*/
+bool myInterface::addNetwork(std::shared_ptr<net_entity> net)
+{
+	std::string name = net->name;
+	if (allNetworks.insert(name, std::move(net)))
+		return true;
+	std::cout << "A network with name " << name << " has been added in the meantime." << std::endl;
+	return false;
+}
+
+/** Keeps the message of a task running in the background until it is printed by printReports.
+*/
+void myInterface::report(std::string message)
+{
+	std::lock_guard<std::mutex> lock(reportsMutex);
+	reports.push_back(std::move(message));
+}
+
+/** Prints the messages of the background tasks and forgets the reloads which have finished.
+*/
+void myInterface::printReports()
+{
+	std::vector<std::string> messages;
+	{
+		std::lock_guard<std::mutex> lock(reportsMutex);
+		messages.swap(reports);
+	}
+	for (const std::string& message : messages)
+		std::cout << message << std::endl;
+	reloads.remove_if([](const std::future<void>& reload)
+		{ return reload.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+}
+
 /** Reads a command from std::cin and calls appropriate function.
 */
 void myInterface::execute()
 {
+	printReports();
 	std::cout << "> ";
 	std::string command;
 	std::cin >> command;
@@ -55,6 +130,8 @@ void myInterface::execute()
 		net_remove();
 	else if (command == "net.read")
 		net_read();
+	else if (command == "net.reload")
+		net_reload();
 	else if (command == "net.save")
 		net_save();
 	else if (command == "net.save.as")
@@ -74,8 +151,30 @@ void myInterface::execute()
 		net_test();
 	else if (command == "net.train")
 		net_train();
+	else if (command == "net.fit")
+		net_fit();
+	else if (command == "net.train.batch")
+		net_train_batch();
+	else if (command == "net.train.parallel")
+		net_train_parallel();
+	else if (command == "net.train.async")
+		net_train_async();
+	else if (command == "net.train.stream")
+		net_train_stream();
+	else if (command == "net.test.stream")
+		net_test_stream();
 	else if (command == "net.compute")
 		net_compute();
+	else if (command == "net.predict")
+		net_predict();
+	else if (command == "net.predict.stream")
+		net_predict_stream();
+	else if (command == "net.stats")
+		net_stats();
+	else if (command == "net.stats.reset")
+		net_stats_reset();
+	else if (command == "net.quantize")
+		net_quantize();
 	else if (command == "list.networks")
 		list_networks();
 	else if (command == "list.sources")
@@ -95,6 +194,12 @@ void myInterface::execute()
 	}
 	else if (command == "set.remove")
 		set_remove();
+	else if (command == "server.start")
+		server_start();
+	else if (command == "server.stop")
+		server_stop();
+	else if (command == "transfer.mode")
+		transfer_select();
 	else if (command == "help")
 		help();
 	else if (command == "end")
@@ -110,14 +215,31 @@ void myInterface::net_make()
 	while (not (std::cin >> networkSize) or networkSize == 0)
 		std::cout << "Enter a valid value. Error at: network size." << std::endl;
 	std::vector<size_t> layerSizes(networkSize);
+	std::vector<activation> activations(networkSize, activation::tanh);
 	for (size_t l = 0; l < networkSize; ++l)
+	{
 		while (not (std::cin >> layerSizes[l]) or layerSizes[l] == 0)
 			std::cout << "Enter a valid value. Error at: layer " << l << " size." << std::endl;
-	allNetworks.push_back(net_entity(layerSizes));
-	std::string networkName;
-	readUniqueName(networkName);
-	allNetworks.back().name = networkName;
-	std::cout << "Network " << networkName << " has been created." << std::endl;
+		if (std::cin.peek() == ':')
+		{
+			std::string name;
+			std::cin.get();
+			std::cin >> name;
+			if (l == 0)
+				std::cout << "The input layer has no activation; " << name << " is ignored." << std::endl;
+			else while (std::cin and (not parseActivation(name, activations[l])
+				or (activations[l] == activation::softmax and l + 1 < networkSize)))
+			{
+				std::cout << "Enter a valid activation. Error at: layer " << l << " activation." << std::endl;
+				std::cin >> name;
+			}
+		}
+	}
+	auto net = std::make_shared<net_entity>(layerSizes, activations);
+	readUniqueName(net->name);
+	std::string networkName = net->name;
+	if (addNetwork(std::move(net)))
+		std::cout << "Network " << networkName << " has been created." << std::endl;
 }
 
 /** Prints information about the network.
@@ -126,18 +248,15 @@ void myInterface::net_print()
 {
 	std::string networkName;
 	std::cin >> networkName;
-	bool printed = false;
-	for (std::list<net_entity>::iterator it = allNetworks.begin();
-		it != allNetworks.end(); ++it)
-		if (it->name == networkName)
-		{
-			std::cout << std::endl;
-			it->network.printNet();
-			printed = true;
-			break;
-		}
-	if (not printed)
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		std::cout << std::endl;
+		net->network.printNet();
+	}
 }
 
 /** From the list of networks removes the network with the name read.
@@ -146,16 +265,7 @@ void myInterface::net_remove()
 {
 	std::string networkName;
 	std::cin >> networkName;
-	bool removed = false;
-	for (std::list<net_entity>::iterator it = allNetworks.begin();
-		it != allNetworks.end(); ++it)
-		if (it->name == networkName)
-		{
-			allNetworks.erase(it);
-			removed = true;
-			break;
-		}
-	if (removed)
+	if (allNetworks.remove(networkName))
 		std::cout << "Network " << networkName << " has been removed." << std::endl;
 	else
 		std::cout << "No such network was found." << std::endl;
@@ -167,40 +277,90 @@ void myInterface::net_read()
 {
 	std::string path, networkName;
 	readSentence(path);
-	allNetworks.push_back(net_entity());
-	allNetworks.back().sourcefile = path;
+	auto net = std::make_shared<net_entity>();
+	net->sourcefile = path;
 	readUniqueName(networkName);
-	allNetworks.back().name = networkName;
+	net->name = networkName;
 	bool success = false;
 	try
 	{
-		allNetworks.back().network.read(path);
-		success = true;
+		net->network.read(path);
+		success = addNetwork(std::move(net));
 	}
 	catch (std::exception exc)
 	{
 		std::cerr << exc.what() << std::endl;
-		allNetworks.pop_back();
 	}
 	if (success)
 		std::cout << "Network " << networkName << " has been successfully read"
 		<< " from \"" << path << "\"." << std::endl;
 }
 
+/** Reads the network again from its source file in the background and, if the layout has not changed,
+* puts the new network in place of the old one at once. The calls which have found the old network
+* before finish with it; the following ones find the new network, so the network is never missing.
+* The changes made to the old network in the meantime are lost.
+*/
+void myInterface::net_reload()
+{
+	std::string networkName;
+	std::cin >> networkName;
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+	{
+		std::cout << "No such network was found." << std::endl;
+		return;
+	}
+	std::string path;
+	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		path = net->sourcefile;
+	}
+	if (extension(path) != ".net" and extension(path) != ".netb")
+	{
+		std::cout << "Network " << networkName << " has no .net or .netb source file to be reloaded from." << std::endl;
+		return;
+	}
+	reloads.push_back(std::async(std::launch::async, [this, net, networkName, path]()
+		{
+			auto fresh = std::make_shared<net_entity>(networkName);
+			fresh->sourcefile = path;
+			try
+			{
+				fresh->network.read(path);
+			}
+			catch (std::exception&)
+			{
+				report("Network " + networkName + " has not been reloaded: " + currentErrorMessage());
+				return;
+			}
+			bool compatible;
+			{
+				std::shared_lock<std::shared_mutex> lock(net->access);
+				compatible = fresh->network.sameLayout(net->network);
+			}
+			if (not compatible)
+				report("Network " + networkName + " has not been reloaded: the layout in \"" + path + "\" is different.");
+			else if (not allNetworks.replace(networkName, net, std::move(fresh)))
+				report("Network " + networkName + " has not been reloaded: it has been removed or replaced in the meantime.");
+			else
+				report("Network " + networkName + " has been reloaded from \"" + path + "\".");
+		}));
+	std::cout << "Network " << networkName << " is being reloaded from \"" << path << "\" in the background." << std::endl;
+}
+
 /** Saves the network to the associated path.
 */
 void myInterface::net_save()
 {
 	std::string networkName;
 	std::cin >> networkName;
-	std::list<net_entity>::iterator net;
-	for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-		if (net->name == networkName)
-			break;
-	if (net == allNetworks.end())
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
 	else
 	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
 		if (net->sourcefile == "")
 			std::cout << "Net " << networkName << " has not been assigned a sourcefile." << std::endl
 			<< "Try calling \"net.save.as\" or \"net.set.source\"." << std::endl;
@@ -210,6 +370,8 @@ void myInterface::net_save()
 				net->network.saveLayout(net->sourcefile);
 			else if (extension(net->sourcefile) == ".net")
 				net->network.saveNetwork(net->sourcefile);
+			else if (extension(net->sourcefile) == ".netb")
+				net->network.saveBinary(net->sourcefile);
 			else
 				std::cout << "Incorrect extension." << std::endl;
 		}
@@ -224,16 +386,14 @@ void myInterface::net_save_as()
 	std::cin >> networkName;
 	readSentence(path);
 	type = extension(path);
-	if (type != ".lay" and type != ".net")
+	if (type != ".lay" and type != ".net" and type != ".netb")
 		throw bad_extension(filetype::net);
-	std::list<net_entity>::iterator net;
-	for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-		if (net->name == networkName)
-			break;
-	if (net == allNetworks.end())
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
 	else
 	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
 		if (net->sourcefile == "")
 			net->sourcefile = path;
 		bool success = false;
@@ -241,8 +401,10 @@ void myInterface::net_save_as()
 		{
 			if (type == ".lay")
 				net->network.saveLayout(path);
-			else
+			else if (type == ".net")
 				net->network.saveNetwork(path);
+			else
+				net->network.saveBinary(path);
 			success = true;
 		}
 		catch (std::exception exc)
@@ -262,18 +424,16 @@ void myInterface::net_set_source()
 	std::cin >> networkName;
 	readSentence(sourcefile);
 	type = extension(sourcefile);
-	if (type != ".lay" and type != ".net")
-		std::cout << "Invalid extension. Acceptable are: \".lay\" and \".net\".";
+	if (type != ".lay" and type != ".net" and type != ".netb")
+		std::cout << "Invalid extension. Acceptable are: \".lay\", \".net\" and \".netb\".";
 	else
 	{
-		std::list<net_entity>::iterator net;
-		for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-			if (net->name == networkName)
-				break;
-		if (net == allNetworks.end())
+		std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+		if (not net)
 			std::cout << "No such network was found." << std::endl;
 		else
 		{
+			std::unique_lock<std::shared_mutex> lock(net->access);
 			net->sourcefile = sourcefile;
 			std::cout << "The source file has been successfully set." << std::endl;
 		}
@@ -286,19 +446,14 @@ void myInterface::net_test()
 {
 	std::string networkName, setName;
 	std::cin >> networkName >> setName;
-	std::list<net_entity>::iterator net;
-	for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-		if (net->name == networkName)
-			break;
-	if (net == allNetworks.end())
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
 	else
 	{
-		std::list<set_entity>::iterator set;
-		for (set = allSets.begin(); set != allSets.end(); ++set)
-			if (set->name == setName)
-				break;
-		if (set == allSets.end())
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
 			std::cout << "No such set was found." << std::endl;
 		else
 		{
@@ -315,19 +470,14 @@ void myInterface::net_train()
 {
 	std::string networkName, setName;
 	std::cin >> networkName >> setName;
-	std::list<net_entity>::iterator net;
-	std::list<set_entity>::iterator set;
-	for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-		if (net->name == networkName)
-			break;
-	if (net == allNetworks.end())
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
 	else
 	{
-		for (set = allSets.begin(); set != allSets.end(); ++set)
-			if (set->name == setName)
-				break;
-		if (set == allSets.end())
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
 			std::cout << "No such set was found." << std::endl;
 		else
 		{
@@ -349,27 +499,272 @@ void myInterface::net_train()
 	}
 }
 
+/** Trains the network for a number of epochs in shuffled order, testing it after every epoch with the validation set.
+* The training stops early if the validation error stops improving. If a .net or .netb checkpoint path follows on the
+* line, the network is saved there every interval epochs, which may follow the path, and once more with the weights kept.
+* The source file of the network is never written.
+*/
+void myInterface::net_fit()
+{
+	std::string networkName, trainingName, validationName;
+	size_t epochs;
+	fit_options options;
+	std::cin >> networkName >> trainingName >> validationName;
+	while (not (std::cin >> epochs) or epochs == 0)
+		std::cout << "Enter a valid value. Error at: epochs." << std::endl;
+	if (argumentFollows())
+	{
+		readSentence(options.checkpointPath);
+		if (argumentFollows())
+			while (not (std::cin >> options.checkpointInterval) or options.checkpointInterval == 0)
+				std::cout << "Enter a valid value. Error at: checkpoint interval." << std::endl;
+		std::string type = extension(options.checkpointPath);
+		if (type != ".net" and type != ".netb")
+		{
+			std::cout << "The checkpoints can be saved only as .net or .netb." << std::endl;
+			return;
+		}
+	}
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+	{
+		std::cout << "No such network was found." << std::endl;
+		return;
+	}
+	std::shared_ptr<set_entity> training = allSets.find(trainingName), validation = allSets.find(validationName);
+	if (not training or not validation)
+	{
+		std::cout << "No such set was found." << std::endl;
+		return;
+	}
+	std::unique_lock<std::shared_mutex> lock(net->access);
+	options.report = [](size_t epoch, double error) {
+		std::cout << std::endl << "Epoch " << epoch << ": the root mean square error with the validation set is equal to: "
+			<< error << std::endl;
+	};
+	try
+	{
+		std::vector<double> errors = net->network.fit(training->set, validation->set, epochs, options);
+		size_t best = size_t(std::min_element(errors.begin(), errors.end()) - errors.begin());
+		std::cout << "Network " << networkName << " has been trained for " << errors.size() << " epochs with set "
+			<< trainingName << "; the weights of epoch " << best + 1 << " are kept." << std::endl;
+		if (not options.checkpointPath.empty())
+			std::cout << "The checkpoints have been saved at \"" << options.checkpointPath << "\"." << std::endl;
+	}
+	catch (incompatible_vectors)
+	{
+		std::cerr << "Set " << trainingName << " or " << validationName << " does not match network "
+			<< networkName << "." << std::endl;
+	}
+	catch (std::exception exc)
+	{
+		std::cerr << exc.what() << std::endl;
+	}
+}
+
+/** Trains the network with the data set in mini-batches.
+*/
+void myInterface::net_train_batch()
+{
+	std::string networkName, setName;
+	size_t batchSize;
+	std::cin >> networkName >> setName;
+	while (not (std::cin >> batchSize) or batchSize == 0)
+		std::cout << "Enter a valid value. Error at: batch size." << std::endl;
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
+			std::cout << "No such set was found." << std::endl;
+		else
+		{
+			bool success = true;
+			try
+			{
+				net->network.trainSet(set->set, batchSize);
+			}
+			catch (incompatible_vectors)
+			{
+				std::cerr << "Training set " << setName << " does not match network "
+					<< networkName << "." << std::endl;
+				success = false;
+			}
+			if (success)
+				std::cout << "Network " << networkName << " has been successfully trained with "
+				<< "set " << setName << " in batches of " << batchSize << " records." << std::endl;
+		}
+	}
+}
+
+/** Trains the network with the data set in mini-batches shared between threads.
+*/
+void myInterface::net_train_parallel()
+{
+	std::string networkName, setName;
+	size_t batchSize, threadsNumber;
+	std::cin >> networkName >> setName;
+	while (not (std::cin >> batchSize) or batchSize == 0)
+		std::cout << "Enter a valid value. Error at: batch size." << std::endl;
+	while (not (std::cin >> threadsNumber) or threadsNumber == 0)
+		std::cout << "Enter a valid value. Error at: threads number." << std::endl;
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
+			std::cout << "No such set was found." << std::endl;
+		else
+		{
+			bool success = true;
+			try
+			{
+				net->network.trainSet(set->set, batchSize, threadsNumber);
+			}
+			catch (incompatible_vectors)
+			{
+				std::cerr << "Training set " << setName << " does not match network "
+					<< networkName << "." << std::endl;
+				success = false;
+			}
+			if (success)
+				std::cout << "Network " << networkName << " has been successfully trained with "
+				<< "set " << setName << " in batches of " << batchSize << " records on "
+				<< threadsNumber << " threads." << std::endl;
+		}
+	}
+}
+
+/** Trains the network with the data set asynchronously on many threads.
+*/
+void myInterface::net_train_async()
+{
+	std::string networkName, setName;
+	size_t threadsNumber;
+	std::cin >> networkName >> setName;
+	while (not (std::cin >> threadsNumber) or threadsNumber == 0)
+		std::cout << "Enter a valid value. Error at: threads number." << std::endl;
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
+			std::cout << "No such set was found." << std::endl;
+		else
+		{
+			bool success = true;
+			try
+			{
+				net->network.trainSetAsync(set->set, threadsNumber);
+			}
+			catch (incompatible_vectors)
+			{
+				std::cerr << "Training set " << setName << " does not match network "
+					<< networkName << "." << std::endl;
+				success = false;
+			}
+			if (success)
+				std::cout << "Network " << networkName << " has been successfully trained with "
+				<< "set " << setName << " asynchronously on " << threadsNumber << " threads." << std::endl;
+		}
+	}
+}
+
+/** Trains the network with the set streamed from the file, without reading the whole set into memory.
+*/
+void myInterface::net_train_stream()
+{
+	std::string networkName, path;
+	std::cin >> networkName;
+	readSentence(path);
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::unique_lock<std::shared_mutex> lock(net->access);
+		bool success = false;
+		try
+		{
+			myDataStream stream(path);
+			net->network.trainSet(stream);
+			success = true;
+		}
+		catch (incompatible_vectors)
+		{
+			std::cerr << "Training set \"" << path << "\" does not match network "
+				<< networkName << "." << std::endl;
+		}
+		catch (std::exception exc)
+		{
+			std::cerr << exc.what() << std::endl;
+		}
+		if (success)
+			std::cout << "Network " << networkName << " has been successfully trained with "
+			<< "the set streamed from \"" << path << "\"." << std::endl;
+	}
+}
+
+/** Tests the network with the set streamed from the file, without reading the whole set into memory.
+*/
+void myInterface::net_test_stream()
+{
+	std::string networkName, path;
+	std::cin >> networkName;
+	readSentence(path);
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		try
+		{
+			myDataStream stream(path);
+			double error = net->network.testSet(stream);
+			std::cout << "Net " << networkName << " has been tested with the set streamed from \"" << path << "\". "
+				"The root mean square error is equal to: " << error << std::endl;
+		}
+		catch (incompatible_vectors)
+		{
+			std::cerr << "Test set \"" << path << "\" does not match network "
+				<< networkName << "." << std::endl;
+		}
+		catch (std::exception exc)
+		{
+			std::cerr << exc.what() << std::endl;
+		}
+	}
+}
+
 /** Makes the network compute outputs for given inputs.
 */
 void myInterface::net_compute()
 {
 	std::string networkName;
 	std::cin >> networkName;
-	std::list<net_entity>::iterator net;
-	for (net = allNetworks.begin(); net != allNetworks.end(); ++net)
-		if (net->name == networkName)
-			break;
-	if (net == allNetworks.end())
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
 		std::cout << "No such network was found." << std::endl;
 	else
 	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
 		if (net->network.empty())
 			std::cout << "Network " << networkName << " is empty." << std::endl;
 		else
 		{
 			bool success = true;
 			size_t size = net->network.inputSize();
-			std::vector<double> values(size);
+			std::vector<double> values(size), results(net->network.outputSize());
 			for (size_t i = 0; i < size; ++i)
 				if (not (std::cin >> values[i]))
 				{
@@ -382,7 +777,7 @@ void myInterface::net_compute()
 				bool moreSuccess = false;
 				try
 				{
-					net->network.propagate(values);
+					net->network.infer(values.data(), values.size(), results.data());
 					moreSuccess = true;
 				}
 				catch (std::exception exc)
@@ -391,16 +786,126 @@ void myInterface::net_compute()
 				}
 				if (moreSuccess)
 				{
-					net->network.getResults(values);
 					std::cout << "Network " << networkName << " has computed the outputs as:" << std::endl;
-					for (size_t i = 0; i < values.size(); ++i)
-						std::cout << "output[" << i << "] = " << values[i] << std::endl;
+					for (size_t i = 0; i < results.size(); ++i)
+						std::cout << "output[" << i << "] = " << results[i] << std::endl;
 				}
 			}
 		}
 	}
 }
 
+/** Computes the outputs of the network for all the records of the set and writes them to the file.
+*/
+void myInterface::net_predict()
+{
+	std::string networkName, setName, path;
+	std::cin >> networkName >> setName;
+	readSentence(path);
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
+			std::cout << "No such set was found." << std::endl;
+		else
+		{
+			try
+			{
+				net->network.predictBatch(set->set, path, 256, defaultThreadsNumber());
+				std::cout << "The outputs of network " << networkName << " for the " << set->set.size()
+					<< " records of set " << setName << " have been written to \"" << path << "\"." << std::endl;
+			}
+			catch (incompatible_vectors)
+			{
+				std::cerr << "Set " << setName << " does not match network " << networkName << "." << std::endl;
+			}
+			catch (std::exception exc)
+			{
+				std::cerr << exc.what() << std::endl;
+			}
+		}
+	}
+}
+
+/** Computes the outputs of the network for all the records of the set streamed from the file and writes them to the file.
+*/
+void myInterface::net_predict_stream()
+{
+	std::string networkName, setPath, path;
+	std::cin >> networkName;
+	readSentence(setPath);
+	readSentence(path);
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		try
+		{
+			myDataStream stream(setPath);
+			net->network.predictBatch(stream, path, 256, defaultThreadsNumber());
+			std::cout << "The outputs of network " << networkName << " for the set streamed from \"" << setPath
+				<< "\" have been written to \"" << path << "\"." << std::endl;
+		}
+		catch (incompatible_vectors)
+		{
+			std::cerr << "Set \"" << setPath << "\" does not match network " << networkName << "." << std::endl;
+		}
+		catch (std::exception exc)
+		{
+			std::cerr << exc.what() << std::endl;
+		}
+	}
+}
+
+/** Quantizes the network to 8 bits, compares the accuracy of both on the set and saves the quantized network.
+*/
+void myInterface::net_quantize()
+{
+	std::string networkName, setName, path;
+	std::cin >> networkName >> setName;
+	readSentence(path);
+	std::shared_ptr<net_entity> net = allNetworks.find(networkName);
+	if (not net)
+		std::cout << "No such network was found." << std::endl;
+	else
+	{
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		std::shared_ptr<set_entity> set = allSets.find(setName);
+		if (not set)
+			std::cout << "No such set was found." << std::endl;
+		else
+		{
+			try
+			{
+				if (extension(path) != ".netq")
+					throw bad_extension(filetype::quantized);
+				myQuantizedNetwork quantized(net->network);
+				double error = quantized.testSet(set->set);
+				double delta = quantized.compare(net->network, set->set);
+				quantized.save(path);
+				std::cout << "Network " << networkName << " has been quantized and saved at \"" << path << "\"." << std::endl
+					<< "The root mean square error with set " << setName << " is equal to: " << error
+					<< " (" << (delta < 0 ? "" : "+") << delta << " against the original network)." << std::endl;
+			}
+			catch (incompatible_vectors)
+			{
+				std::cerr << "Test set " << setName << " does not match network "
+					<< networkName << "." << std::endl;
+			}
+			catch (std::exception exc)
+			{
+				std::cerr << exc.what() << std::endl;
+			}
+		}
+	}
+}
+
 /** Prints the names of the networks read.
 */
 void myInterface::list_networks()
@@ -410,9 +915,8 @@ void myInterface::list_networks()
 	else
 	{
 		std::cout << "Networks:" << std::endl;
-		for (std::list<net_entity>::iterator it = allNetworks.begin();
-			it != allNetworks.end(); ++it)
-			std::cout << " + " << it->name << std::endl;
+		for (const auto& entry : allNetworks.list())
+			std::cout << " + " << entry.first << std::endl;
 	}
 }
 
@@ -425,11 +929,13 @@ void myInterface::list_sources()
 	else
 	{
 		std::cout << "Networks:" << std::endl;
-		for (std::list<net_entity>::iterator it = allNetworks.begin();
-			it != allNetworks.end(); ++it)
-			std::cout << " + " << it->name << (it->sourcefile == "" ?
-				" (no sourcefile)" : " \"" + it->sourcefile + "\"")
+		for (const auto& entry : allNetworks.list())
+		{
+			std::shared_lock<std::shared_mutex> lock(entry.second->access);
+			std::cout << " + " << entry.first << (entry.second->sourcefile == "" ?
+				" (no sourcefile)" : " \"" + entry.second->sourcefile + "\"")
 			<< std::endl;
+		}
 	}
 }
 
@@ -442,9 +948,8 @@ void myInterface::list_sets()
 	else
 	{
 		std::cout << "Sets:" << std::endl;
-		for (std::list<set_entity>::iterator it = allSets.begin();
-			it != allSets.end(); ++it)
-			std::cout << " + " << it->name << "\tsize = " << it->set.size() << std::endl;
+		for (const auto& entry : allSets.list())
+			std::cout << " + " << entry.first << "\tsize = " << entry.second->set.size() << std::endl;
 	}
 }
 
@@ -454,35 +959,19 @@ void myInterface::set_read()
 {
 	std::string path, setName;
 	readSentence(path);
-	allSets.push_back(set_entity());
-	bool success = false;
-	try
-	{
-		allSets.back().set.read(path);
-		success = true;
-	}
-	catch (...)
-	{
-		allSets.pop_back();
-		throw;
-	}
+	auto set = std::make_shared<set_entity>();
+	set->set.read(path);
 	bool occurred;
 	do {
 		std::cin >> setName;
-		occurred = false;
-		for (const auto& s : allNetworks)
-			if (setName == s.name)
-			{
-				occurred = true;
-				break;
-			}
+		set->name = setName;
+		occurred = not allSets.insert(setName, set);
 		if (occurred)
 			std::cout << "A set with such name already exists. Enter a new, unique name: ";
-	} while (occurred);
-	allSets.back().name = setName;
-	if (success)
+	} while (occurred and std::cin);
+	if (not occurred)
 		std::cout << "Set " << setName << " has been successfully read from "
-		<< "\"" << path << "\"; it contains " << allSets.back().set.size()
+		<< "\"" << path << "\"; it contains " << set->set.size()
 		<< " records." << std::endl;
 }
 
@@ -492,41 +981,146 @@ void myInterface::set_remove()
 {
 	std::string setName;
 	std::cin >> setName;
-	bool removed = false;
-	for (std::list<set_entity>::iterator it = allSets.begin();
-		it != allSets.end(); ++it)
-		if (it->name == setName)
-		{
-			allSets.erase(it);
-			removed = true;
-			break;
-		}
-	if (removed)
+	if (allSets.remove(setName))
 		std::cout << "Set " << setName << " has been removed." << std::endl;
 	else
 		std::cout << "No such set was found." << std::endl;
 }
 
+/** Prints the time spent in the phases of the work and the numbers of records and bytes processed.
+*/
+void myInterface::net_stats()
+{
+	if (not statisticsEnabled())
+	{
+		std::cout << "The statistics have been compiled out." << std::endl;
+		return;
+	}
+	double elapsed = elapsedSeconds();
+	std::cout << "Measured for " << elapsed << " s of wall-clock time; the thread seconds are summed over the threads,"
+		<< std::endl << "the rates are per second of the wall-clock time." << std::endl;
+	std::cout << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "calls"
+		<< std::setw(14) << "records" << std::setw(16) << "thread seconds" << std::setw(16) << "records/s"
+		<< std::setw(12) << "MB read" << std::setw(12) << "MB/s" << std::endl;
+	for (size_t p = 0; p < phasesNumber; ++p)
+	{
+		phase_statistics statistics = readStatistics(phase(p));
+		std::cout << std::left << std::setw(12) << phaseName(phase(p)) << std::right << std::setw(12) << statistics.calls
+			<< std::setw(14) << statistics.records << std::setw(16) << statistics.seconds
+			<< std::setw(16) << statistics.records / elapsed << std::setw(12) << statistics.bytes / 1e6
+			<< std::setw(12) << statistics.bytes / 1e6 / elapsed << std::endl;
+	}
+}
+
+/** Sets the statistics to zero.
+*/
+void myInterface::net_stats_reset()
+{
+	resetStatistics();
+	std::cout << "The statistics have been reset." << std::endl;
+}
+
+/** Starts the server answering the requests for the outputs of the networks, replacing the running one.
+*/
+void myInterface::server_start()
+{
+	std::string address;
+	server_options options;
+	size_t wait;
+	readSentence(address);
+	while (not (std::cin >> options.maxBatch) or options.maxBatch == 0)
+		std::cout << "Enter a valid value. Error at: maximal batch size." << std::endl;
+	while (not (std::cin >> wait))
+		std::cout << "Enter a valid value. Error at: maximal wait." << std::endl;
+	while (not (std::cin >> options.workersNumber) or options.workersNumber == 0)
+		std::cout << "Enter a valid value. Error at: workers." << std::endl;
+	options.maxWait = std::chrono::microseconds(wait);
+	if (not server)
+		server = std::make_unique<myServer>(allNetworks);
+	try
+	{
+		server->start(address, options);
+		std::cout << "The server is listening at " << (address.find_first_not_of("0123456789") == std::string::npos ?
+			"port " + address + " of the local host" : "\"" + address + "\"") << "." << std::endl;
+	}
+	catch (std::exception exc)
+	{
+		std::cerr << "The server cannot listen at \"" << address << "\"." << std::endl;
+	}
+}
+
+/** Stops the server after answering the requests already received.
+*/
+void myInterface::server_stop()
+{
+	if (not server or not server->active())
+	{
+		std::cout << "The server is not running." << std::endl;
+		return;
+	}
+	server->stop();
+	std::cout << "The server has been stopped." << std::endl;
+}
+
+/** Chooses whether tanh is computed exactly or approximated.
+*/
+void myInterface::transfer_select()
+{
+	std::string mode;
+	std::cin >> mode;
+	if (mode == "exact")
+		selectTransferMode(transfer_mode::exact);
+	else if (mode == "fast")
+		selectTransferMode(transfer_mode::fast);
+	else
+	{
+		std::cout << "Invalid mode. Acceptable are \"exact\" and \"fast\"." << std::endl;
+		return;
+	}
+	std::cout << "The transfer function is computed in the " << mode << " mode." << std::endl;
+}
 
 /** Prints the help.
 */
 void myInterface::help()
 {
 	std::cout << R"(Commands
- * net.make       number_of_layers layers_sizes net_name .. adds a new network
+ * net.make       number_of_layers layers_sizes net_name .. adds a new network; a size may be followed by
+                  :tanh, :logistic, :relu, :leaky_relu, :linear or (output layer) :softmax
  * net.print      net_name ................................ prints the network
  * net.remove     net_name ................................ deletes the network
  * net.read       path net_name ........................... reads a network from the file
+ * net.reload     net_name ................................ reads the network again from its source file in the background
+                  and puts it in place of the old one if the layout is the same
  * net.save       net_name ................................ saves the network at its assigned source file if provided
  * net.save.as    net_name path ........................... saves the network at the path provided
  * net.set.source net_name path ........................... sets the network source file
  * net.test       net_name set_name ....................... tests the network with the set and tells the RMS error
  * net.train      net_name set_name ....................... trains the network with the set
+ * net.fit        net_name set_name validation_set_name epochs [checkpoint_path [interval]]  trains for epochs in shuffled
+                  order, stopping early when the validation error stops improving; if a .net or .netb path is given,
+                  the network is saved there every interval epochs (1 by default) and at the end with the weights kept
+ * net.train.batch net_name set_name batch_size .......... trains the network with the set in mini-batches
+ * net.train.parallel net_name set_name batch_size threads  trains in mini-batches shared between threads
+ * net.train.async net_name set_name threads ............. trains asynchronously on many threads (Hogwild)
+ * net.train.stream net_name path ........................ trains the network with the set streamed from the file
+ * net.test.stream net_name path ......................... tests the network with the set streamed from the file
  * net.compute    name inputs ............................. computes output for given inputs
+ * net.predict    net_name set_name path .................. writes the outputs for the whole set to the file (raw scalars if .bin)
+ * net.predict.stream net_name set_path path .............. writes the outputs for the set streamed from the file
+ * net.quantize   net_name set_name path .................. quantizes the network to 8 bits, tells the RMS error change and saves it as .netq
+ * net.stats      ......................................... prints the time, records and bytes of propagation, gradients, update,
+                  training record by record and parsing, with the rates over the time since the last reset
+ * net.stats.reset ........................................ sets the statistics to zero
+ * server.start   address max_batch max_wait_us workers .... answers the requests "net_name inputs" sent in lines to the Unix
+                  socket at the path or to the TCP port of the local host, with the outputs, computing them
+                  in batches of requests for one network gathered for at most max_wait_us microseconds
+ * server.stop    ......................................... stops the server
  * set.read       path name ............................... reads a set from the path
  * set.remove     set_name ................................ removes the set
  * list.networks  ......................................... prints names of all networks
  * list.sources   ......................................... prints names and source files of all networks
+ * transfer.mode  exact|fast .............................. computes tanh exactly or approximates it (error below 5e-7)
  * end            ......................................... finishes the program
 )";
 }
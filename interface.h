@@ -2,21 +2,32 @@
 
 #pragma once
 #include "network.h"
+#include "registry.h"
 #include <array>
+#include <future>
 #include <list>
+#include <mutex>
+#include <shared_mutex>
 
 class finish {};
+class myServer;
 
+/** A network of the interface. Its contents, the source file included, are guarded by the lock:
+* the calls which change the network or its outputs hold it exclusively, the others shared.
+*/
 struct net_entity
 {
 	myNetwork network;
 	std::string name, sourcefile;
+	mutable std::shared_mutex access;
 	net_entity() : network(), name(""), sourcefile("") {}
-	net_entity(std::vector<size_t> layout)
-		: network(layout), name(""), sourcefile("") {}
+	net_entity(std::vector<size_t> layout, std::vector<activation> activations = {})
+		: network(layout, activations), name(""), sourcefile("") {}
 	net_entity(std::string _name) : name(_name), sourcefile("") {}
 };
 
+/** A set of the interface, which is not changed once it has been read.
+*/
 struct set_entity
 {
 	myDataSet set;
@@ -25,12 +36,24 @@ struct set_entity
 
 class myInterface
 {
-	std::list<net_entity> allNetworks; 
-	std::list<set_entity> allSets;
+	myRegistry<net_entity> allNetworks;
+	myRegistry<set_entity> allSets;
+	std::unique_ptr<myServer> server;
 	void readSentence(std::string& sentence);
 	void readUniqueName(std::string& name);
+	bool addNetwork(std::shared_ptr<net_entity> net);
+	std::mutex reportsMutex;
+	std::vector<std::string> reports;
+	void report(std::string message);
+	void printReports();
+	/** The reloads running in the background. It is declared last, so that it is destroyed first,
+	* waiting for the reloads, while the rest of the interface is still there.
+	*/
+	std::list<std::future<void>> reloads;
 
 public:
+	myInterface();
+	~myInterface();
 	void execute();
 
 private:
@@ -38,16 +61,31 @@ private:
 	void net_print();
 	void net_remove();
 	void net_read();
+	void net_reload();
 	void net_save();
 	void net_save_as();
 	void net_set_source();
 	void net_test();
 	void net_train();
+	void net_fit();
+	void net_train_batch();
+	void net_train_parallel();
+	void net_train_async();
+	void net_train_stream();
+	void net_test_stream();
 	void net_compute();
+	void net_predict();
+	void net_predict_stream();
+	void net_quantize();
+	void net_stats();
+	void net_stats_reset();
 	void list_networks();
 	void list_sources();
 	void list_sets();
 	void set_read();
 	void set_remove();
+	void server_start();
+	void server_stop();
+	void transfer_select();
 	void help();
-};
\ No newline at end of file
+};
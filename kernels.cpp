@@ -0,0 +1,784 @@
+#include "kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) or defined(_M_X64) or defined(__i386__) or defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(KERNELS_X86) and defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+namespace
+{
+	/** Block sizes chosen so that the tiles being reused stay in the L1 and L2 caches.
+	*/
+	const size_t rowsBlock = 64, columnsBlock = 256, depthBlock = 256;
+
+	template<typename scalar>
+	scalar dotPortable(const scalar* a, const scalar* b, size_t n)
+	{
+		scalar s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			s0 += a[i] * b[i];
+			s1 += a[i + 1] * b[i + 1];
+			s2 += a[i + 2] * b[i + 2];
+			s3 += a[i + 3] * b[i + 3];
+		}
+		for (; i < n; ++i)
+			s0 += a[i] * b[i];
+		return (s0 + s1) + (s2 + s3);
+	}
+
+	template<typename scalar>
+	void axpyPortable(scalar alpha, const scalar* x, scalar* y, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			y[i] += alpha * x[i];
+	}
+
+	template<typename scalar>
+	void momentumUpdatePortable(scalar step, const scalar* x, scalar momentum,
+		scalar* differences, scalar* weights, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			differences[i] = step * x[i] + momentum * differences[i];
+			weights[i] += differences[i];
+		}
+	}
+
+	/** The coefficients of the rational approximation of tanh on [-tanhLimit, tanhLimit],
+	* from the highest power; beyond the limit tanh is rounded to +-1. The absolute error
+	* is below 5e-7 for both float and double.
+	*/
+	const double tanhNumerator[7] = { -2.76076847742355e-16, 2.00018790482477e-13, -8.60467152213735e-11,
+		5.12229709037114e-08, 1.48572235717979e-05, 6.37261928875436e-04, 4.89352455891786e-03 };
+	const double tanhDenominator[4] = { 1.19825839466702e-06, 1.18534705686654e-04,
+		2.26843463243900e-03, 4.89352518554385e-03 };
+	const double tanhLimit = 7.90531110763549805;
+
+	template<typename scalar>
+	scalar rationalTanh(scalar x)
+	{
+		x = x < scalar(-tanhLimit) ? scalar(-tanhLimit) : x > scalar(tanhLimit) ? scalar(tanhLimit) : x;
+		scalar x2 = x * x, p = scalar(tanhNumerator[0]), q = scalar(tanhDenominator[0]);
+		for (size_t k = 1; k < 7; ++k)
+			p = p * x2 + scalar(tanhNumerator[k]);
+		for (size_t k = 1; k < 4; ++k)
+			q = q * x2 + scalar(tanhDenominator[k]);
+		return p * x / q;
+	}
+
+	template<typename scalar>
+	void tanhPortable(scalar* values, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			values[i] = rationalTanh(values[i]);
+	}
+
+	int32_t dotPortable(const int8_t* a, const int8_t* b, size_t n)
+	{
+		int32_t sum = 0;
+		for (size_t i = 0; i < n; ++i)
+			sum += int32_t(a[i]) * int32_t(b[i]);
+		return sum;
+	}
+
+	template<typename scalar>
+	void affinePortable(size_t N, size_t K, const scalar* x, const scalar* weights, const scalar* biases, scalar* y)
+	{
+		std::copy(biases, biases + N, y);
+		for (size_t k = 0; k < K; ++k)
+			axpyPortable(x[k], weights + k * N, y, N);
+	}
+
+#ifdef KERNELS_X86
+	TARGET_AVX2 double dotAvx2(const double* a, const double* b, size_t n)
+	{
+		__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+			s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+		}
+		if (i + 4 <= n)
+		{
+			s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+			i += 4;
+		}
+		s0 = _mm256_add_pd(s0, s1);
+		__m128d h = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+		h = _mm_add_sd(h, _mm_unpackhi_pd(h, h));
+		double sum = _mm_cvtsd_f64(h);
+		for (; i < n; ++i)
+			sum += a[i] * b[i];
+		return sum;
+	}
+
+	TARGET_AVX2 void axpyAvx2(double alpha, const double* x, double* y, size_t n)
+	{
+		__m256d a = _mm256_set1_pd(alpha);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		for (; i < n; ++i)
+			y[i] += alpha * x[i];
+	}
+
+	TARGET_AVX2 void momentumUpdateAvx2(double step, const double* x, double momentum,
+		double* differences, double* weights, size_t n)
+	{
+		__m256d s = _mm256_set1_pd(step), m = _mm256_set1_pd(momentum);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d d = _mm256_fmadd_pd(s, _mm256_loadu_pd(x + i), _mm256_mul_pd(m, _mm256_loadu_pd(differences + i)));
+			_mm256_storeu_pd(differences + i, d);
+			_mm256_storeu_pd(weights + i, _mm256_add_pd(_mm256_loadu_pd(weights + i), d));
+		}
+		for (; i < n; ++i)
+		{
+			differences[i] = step * x[i] + momentum * differences[i];
+			weights[i] += differences[i];
+		}
+	}
+
+	TARGET_AVX2 float dotAvx2(const float* a, const float* b, size_t n)
+	{
+		__m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+			s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+		}
+		if (i + 8 <= n)
+		{
+			s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+			i += 8;
+		}
+		s0 = _mm256_add_ps(s0, s1);
+		__m128 h = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+		h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+		h = _mm_add_ss(h, _mm_movehdup_ps(h));
+		float sum = _mm_cvtss_f32(h);
+		for (; i < n; ++i)
+			sum += a[i] * b[i];
+		return sum;
+	}
+
+	TARGET_AVX2 void axpyAvx2(float alpha, const float* x, float* y, size_t n)
+	{
+		__m256 a = _mm256_set1_ps(alpha);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+		for (; i < n; ++i)
+			y[i] += alpha * x[i];
+	}
+
+	TARGET_AVX2 void momentumUpdateAvx2(float step, const float* x, float momentum,
+		float* differences, float* weights, size_t n)
+	{
+		__m256 s = _mm256_set1_ps(step), m = _mm256_set1_ps(momentum);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 d = _mm256_fmadd_ps(s, _mm256_loadu_ps(x + i), _mm256_mul_ps(m, _mm256_loadu_ps(differences + i)));
+			_mm256_storeu_ps(differences + i, d);
+			_mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), d));
+		}
+		for (; i < n; ++i)
+		{
+			differences[i] = step * x[i] + momentum * differences[i];
+			weights[i] += differences[i];
+		}
+	}
+
+	/** The bytes are widened to 16 bits and multiplied pairwise into 32-bit sums, which cannot overflow.
+	*/
+	TARGET_AVX2 int32_t dotAvx2(const int8_t* a, const int8_t* b, size_t n)
+	{
+		__m256i sum = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			__m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+			__m256i y = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, y));
+		}
+		__m128i h = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, 0x4E));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, 0xB1));
+		int32_t total = _mm_cvtsi128_si32(h);
+		for (; i < n; ++i)
+			total += int32_t(a[i]) * int32_t(b[i]);
+		return total;
+	}
+
+	TARGET_AVX2 void tanhAvx2(double* values, size_t n)
+	{
+		const __m256d limit = _mm256_set1_pd(tanhLimit), negativeLimit = _mm256_set1_pd(-tanhLimit);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256d x = _mm256_max_pd(negativeLimit, _mm256_min_pd(limit, _mm256_loadu_pd(values + i)));
+			__m256d x2 = _mm256_mul_pd(x, x);
+			__m256d p = _mm256_set1_pd(tanhNumerator[0]), q = _mm256_set1_pd(tanhDenominator[0]);
+			for (size_t k = 1; k < 7; ++k)
+				p = _mm256_fmadd_pd(p, x2, _mm256_set1_pd(tanhNumerator[k]));
+			for (size_t k = 1; k < 4; ++k)
+				q = _mm256_fmadd_pd(q, x2, _mm256_set1_pd(tanhDenominator[k]));
+			_mm256_storeu_pd(values + i, _mm256_div_pd(_mm256_mul_pd(p, x), q));
+		}
+		for (; i < n; ++i)
+			values[i] = rationalTanh(values[i]);
+	}
+
+	TARGET_AVX2 void tanhAvx2(float* values, size_t n)
+	{
+		const __m256 limit = _mm256_set1_ps(float(tanhLimit)), negativeLimit = _mm256_set1_ps(float(-tanhLimit));
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 x = _mm256_max_ps(negativeLimit, _mm256_min_ps(limit, _mm256_loadu_ps(values + i)));
+			__m256 x2 = _mm256_mul_ps(x, x);
+			__m256 p = _mm256_set1_ps(float(tanhNumerator[0])), q = _mm256_set1_ps(float(tanhDenominator[0]));
+			for (size_t k = 1; k < 7; ++k)
+				p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(float(tanhNumerator[k])));
+			for (size_t k = 1; k < 4; ++k)
+				q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(float(tanhDenominator[k])));
+			_mm256_storeu_ps(values + i, _mm256_div_ps(_mm256_mul_ps(p, x), q));
+		}
+		for (; i < n; ++i)
+			values[i] = rationalTanh(values[i]);
+	}
+
+	/** Four vectors of the outputs are accumulated in registers over all the inputs, so that no sums
+	* have to be reduced across the lanes; the weights are read row after row.
+	*/
+	TARGET_AVX2 void affineAvx2(size_t N, size_t K, const double* x, const double* weights, const double* biases, double* y)
+	{
+		size_t n = 0;
+		for (; n + 16 <= N; n += 16)
+		{
+			__m256d s0 = _mm256_loadu_pd(biases + n), s1 = _mm256_loadu_pd(biases + n + 4);
+			__m256d s2 = _mm256_loadu_pd(biases + n + 8), s3 = _mm256_loadu_pd(biases + n + 12);
+			for (size_t k = 0; k < K; ++k)
+			{
+				__m256d v = _mm256_broadcast_sd(x + k);
+				const double* row = weights + k * N + n;
+				s0 = _mm256_fmadd_pd(v, _mm256_loadu_pd(row), s0);
+				s1 = _mm256_fmadd_pd(v, _mm256_loadu_pd(row + 4), s1);
+				s2 = _mm256_fmadd_pd(v, _mm256_loadu_pd(row + 8), s2);
+				s3 = _mm256_fmadd_pd(v, _mm256_loadu_pd(row + 12), s3);
+			}
+			_mm256_storeu_pd(y + n, s0);
+			_mm256_storeu_pd(y + n + 4, s1);
+			_mm256_storeu_pd(y + n + 8, s2);
+			_mm256_storeu_pd(y + n + 12, s3);
+		}
+		for (; n + 4 <= N; n += 4)
+		{
+			__m256d s = _mm256_loadu_pd(biases + n);
+			for (size_t k = 0; k < K; ++k)
+				s = _mm256_fmadd_pd(_mm256_broadcast_sd(x + k), _mm256_loadu_pd(weights + k * N + n), s);
+			_mm256_storeu_pd(y + n, s);
+		}
+		for (; n < N; ++n)
+		{
+			double s = biases[n];
+			for (size_t k = 0; k < K; ++k)
+				s += x[k] * weights[k * N + n];
+			y[n] = s;
+		}
+	}
+
+	TARGET_AVX2 void affineAvx2(size_t N, size_t K, const float* x, const float* weights, const float* biases, float* y)
+	{
+		size_t n = 0;
+		for (; n + 32 <= N; n += 32)
+		{
+			__m256 s0 = _mm256_loadu_ps(biases + n), s1 = _mm256_loadu_ps(biases + n + 8);
+			__m256 s2 = _mm256_loadu_ps(biases + n + 16), s3 = _mm256_loadu_ps(biases + n + 24);
+			for (size_t k = 0; k < K; ++k)
+			{
+				__m256 v = _mm256_broadcast_ss(x + k);
+				const float* row = weights + k * N + n;
+				s0 = _mm256_fmadd_ps(v, _mm256_loadu_ps(row), s0);
+				s1 = _mm256_fmadd_ps(v, _mm256_loadu_ps(row + 8), s1);
+				s2 = _mm256_fmadd_ps(v, _mm256_loadu_ps(row + 16), s2);
+				s3 = _mm256_fmadd_ps(v, _mm256_loadu_ps(row + 24), s3);
+			}
+			_mm256_storeu_ps(y + n, s0);
+			_mm256_storeu_ps(y + n + 8, s1);
+			_mm256_storeu_ps(y + n + 16, s2);
+			_mm256_storeu_ps(y + n + 24, s3);
+		}
+		for (; n + 8 <= N; n += 8)
+		{
+			__m256 s = _mm256_loadu_ps(biases + n);
+			for (size_t k = 0; k < K; ++k)
+				s = _mm256_fmadd_ps(_mm256_broadcast_ss(x + k), _mm256_loadu_ps(weights + k * N + n), s);
+			_mm256_storeu_ps(y + n, s);
+		}
+		for (; n < N; ++n)
+		{
+			float s = biases[n];
+			for (size_t k = 0; k < K; ++k)
+				s += x[k] * weights[k * N + n];
+			y[n] = s;
+		}
+	}
+
+	TARGET_AVX512 double dotAvx512(const double* a, const double* b, size_t n)
+	{
+		__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+		size_t i = 0;
+		for (; i + 16 <= n; i += 16)
+		{
+			s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+			s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+		}
+		for (; i < n; i += 8)
+		{
+			__mmask8 mask = n - i >= 8 ? 0xFF : __mmask8((1u << (n - i)) - 1);
+			s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i), s0);
+		}
+		alignas(64) double lanes[8];
+		_mm512_store_pd(lanes, _mm512_add_pd(s0, s1));
+		return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+	}
+
+	TARGET_AVX512 void axpyAvx512(double alpha, const double* x, double* y, size_t n)
+	{
+		__m512d a = _mm512_set1_pd(alpha);
+		for (size_t i = 0; i < n; i += 8)
+		{
+			__mmask8 mask = n - i >= 8 ? 0xFF : __mmask8((1u << (n - i)) - 1);
+			__m512d r = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+			_mm512_mask_storeu_pd(y + i, mask, r);
+		}
+	}
+
+	TARGET_AVX512 void momentumUpdateAvx512(double step, const double* x, double momentum,
+		double* differences, double* weights, size_t n)
+	{
+		__m512d s = _mm512_set1_pd(step), m = _mm512_set1_pd(momentum);
+		for (size_t i = 0; i < n; i += 8)
+		{
+			__mmask8 mask = n - i >= 8 ? 0xFF : __mmask8((1u << (n - i)) - 1);
+			__m512d d = _mm512_fmadd_pd(s, _mm512_maskz_loadu_pd(mask, x + i),
+				_mm512_mul_pd(m, _mm512_maskz_loadu_pd(mask, differences + i)));
+			_mm512_mask_storeu_pd(differences + i, mask, d);
+			_mm512_mask_storeu_pd(weights + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, weights + i), d));
+		}
+	}
+
+	TARGET_AVX512 float dotAvx512(const float* a, const float* b, size_t n)
+	{
+		__m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+		size_t i = 0;
+		for (; i + 32 <= n; i += 32)
+		{
+			s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+			s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+		}
+		for (; i < n; i += 16)
+		{
+			__mmask16 mask = n - i >= 16 ? 0xFFFF : __mmask16((1u << (n - i)) - 1);
+			s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), s0);
+		}
+		alignas(64) float lanes[16];
+		_mm512_store_ps(lanes, _mm512_add_ps(s0, s1));
+		float sum = 0.0f;
+		for (size_t l = 0; l < 16; l += 4)
+			sum += (lanes[l] + lanes[l + 1]) + (lanes[l + 2] + lanes[l + 3]);
+		return sum;
+	}
+
+	TARGET_AVX512 void axpyAvx512(float alpha, const float* x, float* y, size_t n)
+	{
+		__m512 a = _mm512_set1_ps(alpha);
+		for (size_t i = 0; i < n; i += 16)
+		{
+			__mmask16 mask = n - i >= 16 ? 0xFFFF : __mmask16((1u << (n - i)) - 1);
+			__m512 r = _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i));
+			_mm512_mask_storeu_ps(y + i, mask, r);
+		}
+	}
+
+	TARGET_AVX512 void momentumUpdateAvx512(float step, const float* x, float momentum,
+		float* differences, float* weights, size_t n)
+	{
+		__m512 s = _mm512_set1_ps(step), m = _mm512_set1_ps(momentum);
+		for (size_t i = 0; i < n; i += 16)
+		{
+			__mmask16 mask = n - i >= 16 ? 0xFFFF : __mmask16((1u << (n - i)) - 1);
+			__m512 d = _mm512_fmadd_ps(s, _mm512_maskz_loadu_ps(mask, x + i),
+				_mm512_mul_ps(m, _mm512_maskz_loadu_ps(mask, differences + i)));
+			_mm512_mask_storeu_ps(differences + i, mask, d);
+			_mm512_mask_storeu_ps(weights + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), d));
+		}
+	}
+
+	TARGET_AVX512 void affineAvx512(size_t N, size_t K, const double* x, const double* weights, const double* biases, double* y)
+	{
+		size_t n = 0;
+		for (; n + 32 <= N; n += 32)
+		{
+			__m512d s0 = _mm512_loadu_pd(biases + n), s1 = _mm512_loadu_pd(biases + n + 8);
+			__m512d s2 = _mm512_loadu_pd(biases + n + 16), s3 = _mm512_loadu_pd(biases + n + 24);
+			for (size_t k = 0; k < K; ++k)
+			{
+				__m512d v = _mm512_set1_pd(x[k]);
+				const double* row = weights + k * N + n;
+				s0 = _mm512_fmadd_pd(v, _mm512_loadu_pd(row), s0);
+				s1 = _mm512_fmadd_pd(v, _mm512_loadu_pd(row + 8), s1);
+				s2 = _mm512_fmadd_pd(v, _mm512_loadu_pd(row + 16), s2);
+				s3 = _mm512_fmadd_pd(v, _mm512_loadu_pd(row + 24), s3);
+			}
+			_mm512_storeu_pd(y + n, s0);
+			_mm512_storeu_pd(y + n + 8, s1);
+			_mm512_storeu_pd(y + n + 16, s2);
+			_mm512_storeu_pd(y + n + 24, s3);
+		}
+		for (; n < N; n += 8)
+		{
+			__mmask8 mask = N - n >= 8 ? 0xFF : __mmask8((1u << (N - n)) - 1);
+			__m512d s = _mm512_maskz_loadu_pd(mask, biases + n);
+			for (size_t k = 0; k < K; ++k)
+				s = _mm512_fmadd_pd(_mm512_set1_pd(x[k]), _mm512_maskz_loadu_pd(mask, weights + k * N + n), s);
+			_mm512_mask_storeu_pd(y + n, mask, s);
+		}
+	}
+
+	TARGET_AVX512 void affineAvx512(size_t N, size_t K, const float* x, const float* weights, const float* biases, float* y)
+	{
+		size_t n = 0;
+		for (; n + 64 <= N; n += 64)
+		{
+			__m512 s0 = _mm512_loadu_ps(biases + n), s1 = _mm512_loadu_ps(biases + n + 16);
+			__m512 s2 = _mm512_loadu_ps(biases + n + 32), s3 = _mm512_loadu_ps(biases + n + 48);
+			for (size_t k = 0; k < K; ++k)
+			{
+				__m512 v = _mm512_set1_ps(x[k]);
+				const float* row = weights + k * N + n;
+				s0 = _mm512_fmadd_ps(v, _mm512_loadu_ps(row), s0);
+				s1 = _mm512_fmadd_ps(v, _mm512_loadu_ps(row + 16), s1);
+				s2 = _mm512_fmadd_ps(v, _mm512_loadu_ps(row + 32), s2);
+				s3 = _mm512_fmadd_ps(v, _mm512_loadu_ps(row + 48), s3);
+			}
+			_mm512_storeu_ps(y + n, s0);
+			_mm512_storeu_ps(y + n + 16, s1);
+			_mm512_storeu_ps(y + n + 32, s2);
+			_mm512_storeu_ps(y + n + 48, s3);
+		}
+		for (; n < N; n += 16)
+		{
+			__mmask16 mask = N - n >= 16 ? 0xFFFF : __mmask16((1u << (N - n)) - 1);
+			__m512 s = _mm512_maskz_loadu_ps(mask, biases + n);
+			for (size_t k = 0; k < K; ++k)
+				s = _mm512_fmadd_ps(_mm512_set1_ps(x[k]), _mm512_maskz_loadu_ps(mask, weights + k * N + n), s);
+			_mm512_mask_storeu_ps(y + n, mask, s);
+		}
+	}
+#endif
+
+	template<typename scalar>
+	struct kernel_functions
+	{
+		scalar (*dot)(const scalar*, const scalar*, size_t);
+		void (*axpy)(scalar, const scalar*, scalar*, size_t);
+		void (*momentumUpdate)(scalar, const scalar*, scalar, scalar*, scalar*, size_t);
+		void (*tanh)(scalar*, size_t);
+		void (*affine)(size_t, size_t, const scalar*, const scalar*, const scalar*, scalar*);
+	};
+
+	struct kernel_table
+	{
+		instruction_set set;
+		kernel_functions<double> doubles;
+		kernel_functions<float> floats;
+		int32_t (*dotBytes)(const int8_t*, const int8_t*, size_t);
+	};
+
+	kernel_table tableFor(instruction_set set)
+	{
+#ifdef KERNELS_X86
+		if (set == instruction_set::avx512)
+			return { set, { dotAvx512, axpyAvx512, momentumUpdateAvx512, tanhAvx2, affineAvx512 },
+				{ dotAvx512, axpyAvx512, momentumUpdateAvx512, tanhAvx2, affineAvx512 }, dotAvx2 };
+		if (set == instruction_set::avx2)
+			return { set, { dotAvx2, axpyAvx2, momentumUpdateAvx2, tanhAvx2, affineAvx2 },
+				{ dotAvx2, axpyAvx2, momentumUpdateAvx2, tanhAvx2, affineAvx2 }, dotAvx2 };
+#endif
+		return { instruction_set::portable,
+			{ dotPortable<double>, axpyPortable<double>, momentumUpdatePortable<double>, tanhPortable<double>, affinePortable<double> },
+			{ dotPortable<float>, axpyPortable<float>, momentumUpdatePortable<float>, tanhPortable<float>, affinePortable<float> },
+			dotPortable };
+	}
+
+	/** The tables of all the instruction sets, indexed by instruction_set. The kernels in use are switched
+	* by swapping an atomic pointer to one of them, and so is the mode of tanh, so that they may be changed
+	* while other threads compute.
+	*/
+	const kernel_table kernelTables[] = { tableFor(instruction_set::portable), tableFor(instruction_set::avx2),
+		tableFor(instruction_set::avx512) };
+	std::atomic<const kernel_table*> activeKernels(&kernelTables[size_t(detectInstructionSet())]);
+	std::atomic<transfer_mode> activeTransferMode(transfer_mode::exact);
+
+	const kernel_table& kernels()
+	{
+		return *activeKernels.load(std::memory_order_acquire);
+	}
+
+	/** Sets the M x N matrix to zero.
+	*/
+	template<typename scalar>
+	void zero(size_t M, size_t N, scalar* C, size_t ldc)
+	{
+		for (size_t m = 0; m < M; ++m)
+			std::fill(C + m * ldc, C + m * ldc + N, scalar(0));
+	}
+}
+
+/** Returns the widest instruction set supported by the processor and the operating system.
+*/
+instruction_set detectInstructionSet()
+{
+#if defined(KERNELS_X86) and defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return instruction_set::avx512;
+	if (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma"))
+		return instruction_set::avx2;
+#elif defined(KERNELS_X86) and defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = info[2] & (1 << 27), fma = info[2] & (1 << 12);
+	if (not osxsave)
+		return instruction_set::portable;
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(info, 7, 0);
+	bool avx2 = info[1] & (1 << 5), avx512f = info[1] & (1 << 16);
+	if (avx512f and (xcr0 & 0xE6) == 0xE6)
+		return instruction_set::avx512;
+	if (avx2 and fma and (xcr0 & 0x6) == 0x6)
+		return instruction_set::avx2;
+#endif
+	return instruction_set::portable;
+}
+
+/** Returns the instruction set of the kernels in use.
+*/
+instruction_set currentInstructionSet()
+{
+	return kernels().set;
+}
+
+/** Switches the kernels to the instruction set given.
+* @param set the instruction set to be used
+* @return false if the processor does not support the instruction set; the kernels are then left unchanged
+*/
+bool selectInstructionSet(instruction_set set)
+{
+	if (set > detectInstructionSet())
+		return false;
+	activeKernels.store(&kernelTables[size_t(set)], std::memory_order_release);
+	return true;
+}
+
+/** Returns the name of the instruction set.
+*/
+const char* instructionSetName(instruction_set set)
+{
+	switch (set)
+	{
+	case instruction_set::avx512:
+		return "AVX-512";
+	case instruction_set::avx2:
+		return "AVX2";
+	default:
+		return "portable";
+	}
+}
+
+/** Returns the way in which tanh is computed.
+*/
+transfer_mode currentTransferMode()
+{
+	return activeTransferMode.load(std::memory_order_relaxed);
+}
+
+/** Chooses the way in which tanh is computed: exactly, with the standard library, or with
+* the rational approximation, whose absolute error is below 5e-7.
+* @param mode the mode to be used
+*/
+void selectTransferMode(transfer_mode mode)
+{
+	activeTransferMode.store(mode, std::memory_order_relaxed);
+}
+
+/** Returns the dot product of two vectors of length n.
+*/
+double dot(const double* a, const double* b, size_t n)
+{
+	return kernels().doubles.dot(a, b, n);
+}
+
+float dot(const float* a, const float* b, size_t n)
+{
+	return kernels().floats.dot(a, b, n);
+}
+
+/** Returns the dot product of two vectors of n bytes, accumulated in 32 bits.
+*/
+int32_t dot(const int8_t* a, const int8_t* b, size_t n)
+{
+	return kernels().dotBytes(a, b, n);
+}
+
+/** Computes y += alpha * x for vectors of length n.
+*/
+void axpy(double alpha, const double* x, double* y, size_t n)
+{
+	kernels().doubles.axpy(alpha, x, y, n);
+}
+
+void axpy(float alpha, const float* x, float* y, size_t n)
+{
+	kernels().floats.axpy(alpha, x, y, n);
+}
+
+/** Applies the momentum update: differences = step * x + momentum * differences, weights += differences.
+*/
+void momentumUpdate(double step, const double* x, double momentum,
+	double* differences, double* weights, size_t n)
+{
+	kernels().doubles.momentumUpdate(step, x, momentum, differences, weights, n);
+}
+
+void momentumUpdate(float step, const float* x, float momentum,
+	float* differences, float* weights, size_t n)
+{
+	kernels().floats.momentumUpdate(step, x, momentum, differences, weights, n);
+}
+
+/** Replaces every value of the vector of length n with its tanh, computed in the selected mode.
+*/
+void applyTanh(double* values, size_t n)
+{
+	if (activeTransferMode.load(std::memory_order_relaxed) == transfer_mode::fast)
+		kernels().doubles.tanh(values, n);
+	else
+		for (size_t i = 0; i < n; ++i)
+			values[i] = std::tanh(values[i]);
+}
+
+void applyTanh(float* values, size_t n)
+{
+	if (activeTransferMode.load(std::memory_order_relaxed) == transfer_mode::fast)
+		kernels().floats.tanh(values, n);
+	else
+		for (size_t i = 0; i < n; ++i)
+			values[i] = std::tanh(values[i]);
+}
+
+/** Computes y = biases + W^T * x, where x has K values, W is a K x N matrix stored row-major
+* (so that column n holds the input weights of output n) and y has N values; y must not overlap x.
+*/
+void affine(size_t N, size_t K, const double* x, const double* weights, const double* biases, double* y)
+{
+	kernels().doubles.affine(N, K, x, weights, biases, y);
+}
+
+void affine(size_t N, size_t K, const float* x, const float* weights, const float* biases, float* y)
+{
+	kernels().floats.affine(N, K, x, weights, biases, y);
+}
+
+/** Computes C = A * B^T, where A is an M x K matrix, B is an N x K matrix and C is an M x N matrix.
+* The matrices are stored row-major; lda, ldb and ldc are the distances between their consecutive rows.
+*/
+template<typename scalar>
+void gemmNT(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc)
+{
+	zero(M, N, C, ldc);
+	for (size_t k0 = 0; k0 < K; k0 += depthBlock)
+	{
+		size_t depth = std::min(K - k0, depthBlock);
+		for (size_t n0 = 0; n0 < N; n0 += rowsBlock)
+		{
+			size_t n1 = std::min(N, n0 + rowsBlock);
+			for (size_t m = 0; m < M; ++m)
+				for (size_t n = n0; n < n1; ++n)
+					C[m * ldc + n] += dot(A + m * lda + k0, B + n * ldb + k0, depth);
+		}
+	}
+}
+
+/** Computes C = A * B, where A is an M x K matrix, B is a K x N matrix and C is an M x N matrix.
+* The matrices are stored row-major; lda, ldb and ldc are the distances between their consecutive rows.
+*/
+template<typename scalar>
+void gemmNN(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc)
+{
+	zero(M, N, C, ldc);
+	for (size_t n0 = 0; n0 < N; n0 += columnsBlock)
+	{
+		size_t width = std::min(N - n0, columnsBlock);
+		for (size_t k0 = 0; k0 < K; k0 += depthBlock)
+		{
+			size_t k1 = std::min(K, k0 + depthBlock);
+			for (size_t m = 0; m < M; ++m)
+				for (size_t k = k0; k < k1; ++k)
+					axpy(A[m * lda + k], B + k * ldb + n0, C + m * ldc + n0, width);
+		}
+	}
+}
+
+/** Computes C = A^T * B, where A is a K x M matrix, B is a K x N matrix and C is an M x N matrix.
+* The matrices are stored row-major; lda, ldb and ldc are the distances between their consecutive rows.
+*/
+template<typename scalar>
+void gemmTN(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc)
+{
+	zero(M, N, C, ldc);
+	for (size_t m0 = 0; m0 < M; m0 += rowsBlock)
+	{
+		size_t m1 = std::min(M, m0 + rowsBlock);
+		for (size_t n0 = 0; n0 < N; n0 += columnsBlock)
+		{
+			size_t width = std::min(N - n0, columnsBlock);
+			for (size_t k = 0; k < K; ++k)
+				for (size_t m = m0; m < m1; ++m)
+					axpy(A[k * lda + m], B + k * ldb + n0, C + m * ldc + n0, width);
+		}
+	}
+}
+
+template void gemmNT<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t);
+template void gemmNT<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t);
+template void gemmNN<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t);
+template void gemmNN<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t);
+template void gemmTN<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t);
+template void gemmTN<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t);
@@ -0,0 +1,39 @@
+/**@file*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class instruction_set { portable, avx2, avx512 };
+enum class transfer_mode { exact, fast };
+
+instruction_set detectInstructionSet();
+instruction_set currentInstructionSet();
+bool selectInstructionSet(instruction_set set);
+const char* instructionSetName(instruction_set set);
+transfer_mode currentTransferMode();
+void selectTransferMode(transfer_mode mode);
+
+double dot(const double* a, const double* b, size_t n);
+float dot(const float* a, const float* b, size_t n);
+int32_t dot(const int8_t* a, const int8_t* b, size_t n);
+void axpy(double alpha, const double* x, double* y, size_t n);
+void axpy(float alpha, const float* x, float* y, size_t n);
+void momentumUpdate(double step, const double* x, double momentum,
+	double* differences, double* weights, size_t n);
+void momentumUpdate(float step, const float* x, float momentum,
+	float* differences, float* weights, size_t n);
+void applyTanh(double* values, size_t n);
+void applyTanh(float* values, size_t n);
+void affine(size_t N, size_t K, const double* x, const double* weights, const double* biases, double* y);
+void affine(size_t N, size_t K, const float* x, const float* weights, const float* biases, float* y);
+
+template<typename scalar>
+void gemmNT(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc);
+template<typename scalar>
+void gemmNN(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc);
+template<typename scalar>
+void gemmTN(size_t M, size_t N, size_t K, const scalar* A, size_t lda,
+	const scalar* B, size_t ldb, scalar* C, size_t ldc);
@@ -0,0 +1,284 @@
+#include "layer.h"
+#include "kernels.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+/** Constructor
+* @param _neuronsNumber the number of neurons (excluding the bias)
+* @param _inputsNumber the number of input weights of each neuron (including the previous bias)
+* @param _activationFunction the activation function of the neurons
+*/
+template<typename scalar>
+myBasicLayer<scalar>::myBasicLayer(size_t _neuronsNumber, size_t _inputsNumber, activation _activationFunction)
+	: neuronsNumber(_neuronsNumber), inputsNumber(_inputsNumber), activationFunction(_activationFunction),
+	ownWeights(_neuronsNumber * _inputsNumber), weights(ownWeights.data()),
+	outputValues(_neuronsNumber + 1, 1.0), gradientValues(_neuronsNumber + 1, 0.0)
+{
+	for (auto& weight : ownWeights)
+		weight = random();
+}
+
+/** Constructor of a layer whose weights are stored elsewhere, e.g. in a file mapped into memory.
+* @param _neuronsNumber the number of neurons (excluding the bias)
+* @param _inputsNumber the number of input weights of each neuron (including the previous bias)
+* @param mappedWeights pointer to the weights, which must outlive the layer
+* @param _activationFunction the activation function of the neurons
+*/
+template<typename scalar>
+myBasicLayer<scalar>::myBasicLayer(size_t _neuronsNumber, size_t _inputsNumber, scalar* mappedWeights, activation _activationFunction)
+	: neuronsNumber(_neuronsNumber), inputsNumber(_inputsNumber), activationFunction(_activationFunction), weights(mappedWeights),
+	outputValues(_neuronsNumber + 1, 1.0), gradientValues(_neuronsNumber + 1, 0.0)
+{
+}
+
+/** Copy constructor; the weights are always copied into the memory owned by the new layer.
+*/
+template<typename scalar>
+myBasicLayer<scalar>::myBasicLayer(const myBasicLayer& other)
+	: neuronsNumber(other.neuronsNumber), inputsNumber(other.inputsNumber), activationFunction(other.activationFunction),
+	ownWeights(other.weights, other.weights + other.weightsNumber()), weights(ownWeights.data()),
+	weightDifferences(other.weightDifferences),
+	outputValues(other.outputValues), gradientValues(other.gradientValues)
+{
+}
+
+/** Copy assignment; the weights are always copied into the memory owned by this layer.
+*/
+template<typename scalar>
+myBasicLayer<scalar>& myBasicLayer<scalar>::operator=(const myBasicLayer& other)
+{
+	if (this != &other)
+		*this = myBasicLayer(other);
+	return *this;
+}
+
+/** Makes the layer use the weights stored elsewhere instead of its own.
+* @param values pointer to the weights, which must outlive the layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::mapWeights(scalar* values)
+{
+	weights = values;
+	ownWeights.clear();
+	ownWeights.shrink_to_fit();
+}
+
+/** Allocates the momentum terms, which are needed only for training.
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::prepareTraining()
+{
+	if (weightDifferences.size() != weightsNumber())
+		weightDifferences.assign(weightsNumber(), 0.0);
+}
+
+/** Computes the outputs of the neurons.
+* @param prevLayer reference to the previous layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeOutputs(const myBasicLayer& prevLayer)
+{
+	assert(prevLayer.size() == inputsNumber);
+	const scalar* inputValues = prevLayer.outputs();
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		outputValues[n] = dot(inputValues, &weights[n * inputsNumber], inputsNumber);
+	activate(activationFunction, outputValues.data(), neuronsNumber);
+}
+
+/** Computes the gradients for the target values according to the formula for the output layer.
+* @param targets the target values, one per neuron
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeOutputGradients(const scalar* targets)
+{
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		gradientValues[n] = targets[n] - outputValues[n];
+	multiplyDerivative(activationFunction, outputValues.data(), gradientValues.data(), neuronsNumber);
+}
+
+/** Computes the gradients according to the formula for the hidden layers.
+* @param nextLayer reference to the next layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeHiddenGradients(const myBasicLayer& nextLayer)
+{
+	assert(nextLayer.inputsNumber == size());
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		gradientValues[n] = 0.0;
+	for (size_t k = 0; k < nextLayer.neuronsNumber; ++k)
+		axpy(nextLayer.gradientValues[k], &nextLayer.weights[k * nextLayer.inputsNumber],
+			gradientValues.data(), neuronsNumber);
+	multiplyDerivative(activationFunction, outputValues.data(), gradientValues.data(), neuronsNumber);
+}
+
+/** Improves the input weights.
+* @param prevLayer reference to the previous layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::improveInputWeights(const myBasicLayer& prevLayer)
+{
+	assert(prevLayer.size() == inputsNumber);
+	assert(weightDifferences.size() == weightsNumber());
+	const scalar* inputValues = prevLayer.outputs();
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		momentumUpdate(scalar(myLearning::learningRate) * gradientValues[n], inputValues, scalar(myLearning::momentum),
+			&weightDifferences[n * inputsNumber], &weights[n * inputsNumber], inputsNumber);
+}
+
+/** Prepares the buffers of the layer for a batch of records. The outputs of the bias are set in every
+* record, so the values may have been used by a layer of another size before; the buffers keep their
+* capacity when they shrink, so they are reallocated only beyond their largest size. The gradients of the
+* weights are allocated only once they are computed, so the values used for inference stay small.
+* @param values the batch values of the layer
+* @param batchSize the number of records in the batch
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::resizeBatch(myBasicBatchValues<scalar>& values, size_t batchSize) const
+{
+	values.batchSize = batchSize;
+	values.outputValues.resize(batchSize * size());
+	for (size_t r = 0; r < batchSize; ++r)
+		values.outputValues[r * size() + neuronsNumber] = scalar(1);
+	values.gradientValues.resize(batchSize * neuronsNumber);
+}
+
+/** Sets the outputs of the input layer for one record of the batch.
+* @param own the batch values of this layer
+* @param record the index of the record in the batch
+* @param inputs pointer to the input values of the record
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::setBatchInputs(myBasicBatchValues<scalar>& own, size_t record, const scalar* inputs) const
+{
+	assert(record < own.batchSize);
+	std::copy(inputs, inputs + neuronsNumber, own.outputValues.begin() + record * size());
+}
+
+/** Computes the outputs of the neurons for the whole batch.
+* @param prev the batch values of the previous layer
+* @param own the batch values of this layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeBatchOutputs(const myBasicBatchValues<scalar>& prev, myBasicBatchValues<scalar>& own) const
+{
+	assert(prev.batchSize == own.batchSize);
+	gemmNT(own.batchSize, neuronsNumber, inputsNumber, prev.outputValues.data(), inputsNumber,
+		weights, inputsNumber, own.outputValues.data(), size());
+	for (size_t r = 0; r < own.batchSize; ++r)
+		activate(activationFunction, &own.outputValues[r * size()], neuronsNumber);
+}
+
+/** Computes the gradients according to the formula for the output layer for one record of the batch.
+* @param own the batch values of this layer
+* @param record the index of the record in the batch
+* @param targets pointer to the target values of the record
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeBatchOutputGradients(myBasicBatchValues<scalar>& own, size_t record, const scalar* targets) const
+{
+	assert(record < own.batchSize);
+	const scalar* outputs = &own.outputValues[record * size()];
+	scalar* gradients = &own.gradientValues[record * neuronsNumber];
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		gradients[n] = targets[n] - outputs[n];
+	multiplyDerivative(activationFunction, outputs, gradients, neuronsNumber);
+}
+
+/** Computes the gradients according to the formula for the hidden layers for the whole batch.
+* @param nextLayer reference to the next layer
+* @param next the batch values of the next layer
+* @param own the batch values of this layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeBatchHiddenGradients(const myBasicLayer& nextLayer, const myBasicBatchValues<scalar>& next, myBasicBatchValues<scalar>& own) const
+{
+	assert(nextLayer.inputsNumber == size() and next.batchSize == own.batchSize);
+	gemmNN(own.batchSize, neuronsNumber, nextLayer.neuronsNumber, next.gradientValues.data(),
+		nextLayer.neuronsNumber, nextLayer.weights, nextLayer.inputsNumber,
+		own.gradientValues.data(), neuronsNumber);
+	for (size_t r = 0; r < own.batchSize; ++r)
+		multiplyDerivative(activationFunction, &own.outputValues[r * size()],
+			&own.gradientValues[r * neuronsNumber], neuronsNumber);
+}
+
+/** Computes the gradients of the input weights summed over the whole batch.
+* @param prev the batch values of the previous layer
+* @param own the batch values of this layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::computeWeightGradients(const myBasicBatchValues<scalar>& prev, myBasicBatchValues<scalar>& own) const
+{
+	assert(prev.batchSize == own.batchSize);
+	own.weightGradients.resize(weightsNumber());
+	gemmTN(neuronsNumber, inputsNumber, own.batchSize, own.gradientValues.data(), neuronsNumber,
+		prev.outputValues.data(), inputsNumber, own.weightGradients.data(), inputsNumber);
+}
+
+/** Improves the input weights with the gradients of the single record of the batch.
+* @param prev the batch values of the previous layer
+* @param own the batch values of this layer
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::improveInputWeights(const myBasicBatchValues<scalar>& prev, const myBasicBatchValues<scalar>& own)
+{
+	assert(prev.batchSize == 1 and own.batchSize == 1 and weightDifferences.size() == weightsNumber());
+	for (size_t n = 0; n < neuronsNumber; ++n)
+		momentumUpdate(scalar(myLearning::learningRate) * own.gradientValues[n], prev.outputValues.data(), scalar(myLearning::momentum),
+			&weightDifferences[n * inputsNumber], &weights[n * inputsNumber], inputsNumber);
+}
+
+/** Improves a range of the input weights once with the gradients averaged over the records.
+* @param weightGradients the gradients of all the input weights summed over the records
+* @param recordsNumber the number of records over which the gradients have been summed
+* @param first the index of the first weight of the range
+* @param count the number of weights in the range
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::improveInputWeights(const scalar* weightGradients, size_t recordsNumber, size_t first, size_t count)
+{
+	assert(first + count <= weightDifferences.size());
+	momentumUpdate(scalar(myLearning::learningRate / recordsNumber), weightGradients + first, scalar(myLearning::momentum),
+		&weightDifferences[first], &weights[first], count);
+}
+
+/** Returns the value of the weight between two neurons.
+* @param neuron the index of the final neuron of the weight
+* @param initial the index of the initial neuron of the weight
+*/
+template<typename scalar>
+scalar myBasicLayer<scalar>::getWeight(size_t neuron, size_t initial) const
+{
+	if (neuron >= neuronsNumber or initial >= inputsNumber)
+		throw out_of_range();
+	else
+		return weights[neuron * inputsNumber + initial];
+}
+
+/** Sets the values of the input weights of the neuron.
+* @param neuron the index of the neuron
+* @param values the new values of the weights
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::setInputWeights(size_t neuron, const std::vector<scalar>& values)
+{
+	assert(neuron < neuronsNumber and values.size() == inputsNumber);
+	for (size_t w = 0; w < inputsNumber; ++w)
+		weights[neuron * inputsNumber + w] = values[w];
+}
+
+/** Prints the input weights of the neuron.
+* @param neuron the index of the neuron
+*/
+template<typename scalar>
+void myBasicLayer<scalar>::printWeights(size_t neuron)
+{
+	if (neuron >= neuronsNumber or inputsNumber == 0)
+		std::cout << "        The neuron has no weights." << std::endl;
+	else
+		for (size_t w = 0; w < inputsNumber; ++w)
+			std::cout << "        Weight " << w << " has the value: " << weights[neuron * inputsNumber + w] << "." << std::endl;
+}
+
+template class myBasicLayer<float>;
+template class myBasicLayer<double>;
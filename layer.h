@@ -0,0 +1,98 @@
+/**@file*/
+
+#pragma once
+#include "activation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+class out_of_range : public std::exception
+{
+public:
+	const char* what() { return "An attempt of accessing an element that is out of range."; }
+};
+
+/** The outputs and gradients of a layer for a batch of records, stored as matrices with one row per record.
+* Every thread keeps its own values, so that the layers can be shared.
+*/
+template<typename scalar>
+struct myBasicBatchValues
+{
+	size_t batchSize = 0;
+	std::vector<scalar> outputValues, gradientValues, weightGradients;
+};
+
+using myBatchValues = myBasicBatchValues<double>;
+
+/** The parameters of the learning, shared by the layers of every scalar type.
+*/
+struct myLearning
+{
+	static double learningRate, momentum;
+};
+
+/** A layer of neurons stored as dense row-major matrices.
+* Row n of the weight matrix holds the input weights of neuron n; the last column belongs to
+* the bias of the previous layer. The output of the bias of this layer is kept as the last
+* element of the output vector and is always equal to 1.0. The weights are normally owned by the
+* layer, but may also live in a file mapped into memory; the momentum terms are allocated only
+* once the layer is trained. Every layer has its own activation function. The scalar type of
+* the weights and the values is either float or double.
+*/
+template<typename scalar>
+class myBasicLayer
+{
+	size_t neuronsNumber, inputsNumber;
+	activation activationFunction;
+	std::vector<scalar> ownWeights;
+	scalar* weights;
+	std::vector<scalar> weightDifferences;
+	std::vector<scalar> outputValues, gradientValues;
+
+	static scalar random() { return scalar(rand() / double(RAND_MAX) * (rand() % 2 ? -1 : +1)); }
+
+public:
+	myBasicLayer(size_t _neuronsNumber, size_t _inputsNumber, activation _activationFunction = activation::tanh);
+	myBasicLayer(size_t _neuronsNumber, size_t _inputsNumber, scalar* mappedWeights, activation _activationFunction = activation::tanh);
+	myBasicLayer(const myBasicLayer& other);
+	myBasicLayer(myBasicLayer&& other) = default;
+	myBasicLayer& operator=(const myBasicLayer& other);
+	myBasicLayer& operator=(myBasicLayer&& other) = default;
+
+	size_t size() const { return neuronsNumber + 1; }
+	size_t inputs() const { return inputsNumber; }
+	activation getActivation() const { return activationFunction; }
+	void setActivation(activation function) { activationFunction = function; }
+
+	void setOutput(size_t neuron, scalar value) { outputValues[neuron] = value; }
+	void setOutputs(const scalar* values) { std::copy(values, values + neuronsNumber, outputValues.begin()); }
+	scalar getOutput(size_t neuron) const { return outputValues[neuron]; }
+	const scalar* outputs() const { return outputValues.data(); }
+
+	void computeOutputs(const myBasicLayer& prevLayer);
+	void computeOutputGradients(const scalar* targets);
+	void computeHiddenGradients(const myBasicLayer& nextLayer);
+	void improveInputWeights(const myBasicLayer& prevLayer);
+
+	void resizeBatch(myBasicBatchValues<scalar>& values, size_t batchSize) const;
+	void setBatchInputs(myBasicBatchValues<scalar>& own, size_t record, const scalar* inputs) const;
+	void computeBatchOutputs(const myBasicBatchValues<scalar>& prev, myBasicBatchValues<scalar>& own) const;
+	void computeBatchOutputGradients(myBasicBatchValues<scalar>& own, size_t record, const scalar* targets) const;
+	void computeBatchHiddenGradients(const myBasicLayer& nextLayer, const myBasicBatchValues<scalar>& next, myBasicBatchValues<scalar>& own) const;
+	void computeWeightGradients(const myBasicBatchValues<scalar>& prev, myBasicBatchValues<scalar>& own) const;
+	void improveInputWeights(const myBasicBatchValues<scalar>& prev, const myBasicBatchValues<scalar>& own);
+	void improveInputWeights(const scalar* weightGradients, size_t recordsNumber, size_t first, size_t count);
+	size_t weightsNumber() const { return neuronsNumber * inputsNumber; }
+	const scalar* weightValues() const { return weights; }
+	void mapWeights(scalar* values);
+	void prepareTraining();
+
+	scalar getWeight(size_t neuron, size_t initial) const;
+	void setInputWeights(size_t neuron, const std::vector<scalar>& values);
+	void printWeights(size_t neuron);
+};
+
+using myLayer = myBasicLayer<double>;
@@ -6,8 +6,8 @@
 #include <ctime>
 #include <iomanip>
 
-double myNeuron::learningRate = 0.01;
-double myNeuron::momentum = 0.5;
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
 
 int main()
 {
@@ -0,0 +1,65 @@
+#include "mapping.h"
+#include "network.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Maps the file.
+* @param path the path of the file
+*/
+myMappedFile::myMappedFile(const std::string& path) : address(nullptr), length(0)
+{
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		throw no_file();
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	length = size_t(fileSize.QuadPart);
+	mappingHandle = length == 0 ? NULL : CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if (mappingHandle != NULL)
+		address = static_cast<char*>(MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0));
+	if (address == nullptr)
+	{
+		if (mappingHandle != NULL)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		throw incomplete_contents();
+	}
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		throw no_file();
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 or status.st_size == 0)
+	{
+		close(descriptor);
+		throw incomplete_contents();
+	}
+	length = size_t(status.st_size);
+	void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (mapped == MAP_FAILED)
+		throw incomplete_contents();
+	address = static_cast<char*>(mapped);
+#endif
+}
+
+/** Unmaps the file.
+*/
+myMappedFile::~myMappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(address);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+#else
+	munmap(address, length);
+#endif
+}
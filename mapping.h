@@ -0,0 +1,26 @@
+/**@file*/
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+/** A file mapped privately into memory. Writes to the mapping are copy-on-write and never reach the file.
+*/
+class myMappedFile
+{
+	char* address;
+	size_t length;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+public:
+	myMappedFile(const std::string& path);
+	~myMappedFile();
+	myMappedFile(const myMappedFile&) = delete;
+	myMappedFile& operator=(const myMappedFile&) = delete;
+
+	char* data() const { return address; }
+	size_t size() const { return length; }
+};
@@ -1,14 +1,113 @@
 #include "network.h"
+#include "kernels.h"
+#include "statistics.h"
+#include "threads.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <string>
 
+namespace
+{
+	/** The header of a .netb file. It is followed by the sizes of the layers as 64-bit integers,
+	* by their activation functions as 64-bit integers (since version 2; before, all of them used tanh)
+	* and by the weight matrices of the layers, all of them starting at multiples of blockAlignment.
+	* The checksum covers everything after the header, padding included.
+	*/
+	struct netb_header
+	{
+		char magic[4];
+		uint32_t endianness, version, scalarSize;
+		uint64_t layersNumber, checksum;
+	};
+
+	const char netbMagic[4] = { 'N', 'E', 'T', 'B' };
+	const uint32_t netbEndianness = 0x01020304, netbVersion = 2;
+	const size_t blockAlignment = 64;
+
+	size_t aligned(size_t offset)
+	{
+		return (offset + blockAlignment - 1) / blockAlignment * blockAlignment;
+	}
+
+	/** Continues the FNV-1a hash over 64-bit words.
+	* @param hash the hash of the preceding data
+	* @param data pointer to the data, whose length must be a multiple of 8 bytes
+	* @param length the length of the data in bytes
+	*/
+	uint64_t checksum(uint64_t hash, const char* data, size_t length)
+	{
+		for (size_t i = 0; i + 8 <= length; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	const uint64_t checksumBasis = 14695981039346656037ull;
+
+	/** Writes the outputs of the records, either as raw scalars or as text, one record per line.
+	* @param file the stream to which the outputs shall be written
+	* @param binary whether the outputs shall be written as raw scalars
+	* @param outputs pointer to the outputs, record after record
+	* @param recordsNumber the number of records
+	* @param width the number of outputs of a record
+	*/
+	template<typename scalar>
+	void writePredictions(std::ofstream& file, bool binary, const scalar* outputs, size_t recordsNumber, size_t width)
+	{
+		if (binary)
+		{
+			file.write(reinterpret_cast<const char*>(outputs), recordsNumber * width * sizeof(scalar));
+			return;
+		}
+		std::string text;
+		text.reserve(recordsNumber * width * 12);
+		char number[32];
+		for (size_t r = 0; r < recordsNumber; ++r)
+			for (size_t i = 0; i < width; ++i)
+			{
+				auto result = std::to_chars(number, number + sizeof(number), outputs[r * width + i]);
+				text.append(number, result.ptr);
+				text += i + 1 < width ? ' ' : '\n';
+			}
+		file.write(text.data(), text.size());
+	}
+
+	std::ofstream openPredictions(const std::string& path)
+	{
+		std::ofstream file(path, std::ios::out | std::ios::binary);
+		if (not file.good())
+			throw bad_path();
+		return file;
+	}
+}
+
+/** Allocates the momentum terms of the layers before training.
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::prepareTraining()
+{
+	for (auto& layer : networkBody)
+		layer.prepareTraining();
+}
+
 /** Prints information about the network.
 */
-void myNetwork::printNet()
+template<typename scalar>
+void myBasicNetwork<scalar>::printNet()
 {
 	if (networkBody.empty())
 	{
@@ -18,11 +117,14 @@ void myNetwork::printNet()
 	std::cout << "The network consists of " << networkBody.size() << " layers." << std::endl;
 	for (size_t l = 0; l < networkBody.size(); ++l)
 	{
-		std::cout << "Layer " << l << " has " << networkBody[l].size() << " neurons (including the bias)." << std::endl;
+		std::cout << "Layer " << l << " has " << networkBody[l].size() << " neurons (including the bias)";
+		if (l > 0)
+			std::cout << " activated with " << activationName(networkBody[l].getActivation());
+		std::cout << "." << std::endl;
 		for (size_t n = 0; n < networkBody[l].size(); ++n)
 		{
 			std::cout << "    Neuron " << n << " has the weights: " << std::endl;
-			networkBody[l][n].printWeights();
+			networkBody[l].printWeights(n);
 		}
 	}
 	std::cout << std::endl << "The outputs of the neurons are:" << std::endl;
@@ -32,86 +134,239 @@ void myNetwork::printNet()
 		for (size_t n = 0; n < networkBody[l].size(); ++n)
 		{
 			std::cout << "    Neuron " << n << " has the output "
-				<< networkBody[l][n].getOutput() << "." << std::endl;
+				<< networkBody[l].getOutput(n) << "." << std::endl;
 		}
 	}
 	std::cout << std::endl;
 }
 
+/** Performs propagation.
+* @param inputs pointer to inputSize() input values
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::propagate(const scalar* inputs)
+{
+	networkBody[0].setOutputs(inputs);
+	for (size_t l = 1; l < networkBody.size(); ++l)
+		networkBody[l].computeOutputs(networkBody[l - 1]);
+}
+
 /** Performs propagation.
 * @param inputs the vector of input values
 */
-void myNetwork::propagate(std::vector<double> inputs)
+template<typename scalar>
+void myBasicNetwork<scalar>::propagate(const std::vector<scalar>& inputs)
 {
 	if (inputs.size() != networkBody[0].size() - 1)
 		throw incompatible_vectors();
-	for (size_t i = 0; i < inputs.size(); ++i)
-		networkBody[0][i].setOutput(inputs[i]);
+	propagate(inputs.data());
+}
+
+/** Computes the outputs for the inputs in the workspace of the calling thread, which is kept between
+* the calls and shared by all the networks the thread infers with. The network is not changed, so it
+* may infer on many threads at once. No memory is allocated once the workspace has grown to the network.
+* Single records are not timed by the statistics.
+* @param inputs pointer to the input values
+* @param size the number of the input values
+* @param outputs pointer to the buffer of outputSize() values to which the outputs shall be written
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::infer(const scalar* inputs, size_t size, scalar* outputs) const
+{
+	thread_local myBasicWorkspace<scalar> workspace;
+	infer(inputs, size, outputs, workspace);
+}
+
+/** Computes the outputs for the inputs in the given workspace, without timing it. The network is not changed.
+* @param inputs pointer to the input values
+* @param size the number of the input values
+* @param outputs pointer to the buffer of outputSize() values to which the outputs shall be written
+* @param workspace the values of the layers, grown to the network if needed, which no other thread may use during the call
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::infer(const scalar* inputs, size_t size, scalar* outputs, myBasicWorkspace<scalar>& workspace) const
+{
+	if (networkBody.empty() or size != inputSize())
+		throw incompatible_vectors();
+	propagateRecords(inputs, 1, outputs, workspace);
+}
+
+/** Computes the outputs for a batch of records at once in the given workspace. The network is not changed.
+* @param inputs pointer to count * inputSize() input values, record after record
+* @param count the number of the records
+* @param outputs pointer to the buffer of count * outputSize() values to which the outputs shall be written, record after record
+* @param workspace the values of the layers, which no other thread may use during the call; it is only ever grown,
+* so that a thread alternating between networks of different sizes keeps the buffers of the largest
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::inferBatch(const scalar* inputs, size_t count, scalar* outputs, myBasicWorkspace<scalar>& workspace) const
+{
+	if (networkBody.empty())
+		throw incompatible_vectors();
+	myPhaseTimer timer(phase::propagation, count);
+	propagateRecords(inputs, count, outputs, workspace);
+}
+
+/** Computes the outputs for records given one after another, without timing it.
+* @param inputs pointer to count * inputSize() input values, record after record
+* @param count the number of the records
+* @param outputs pointer to the buffer of count * outputSize() values to which the outputs shall be written, record after record
+* @param workspace the values of the layers, grown to the network if needed
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::propagateRecords(const scalar* inputs, size_t count, scalar* outputs, myBasicWorkspace<scalar>& workspace) const
+{
+	if (workspace.size() < networkBody.size())
+		workspace.resize(networkBody.size());
+	for (size_t l = 0; l < networkBody.size(); ++l)
+		networkBody[l].resizeBatch(workspace[l], count);
+	for (size_t r = 0; r < count; ++r)
+		networkBody.front().setBatchInputs(workspace.front(), r, inputs + r * inputSize());
 	for (size_t l = 1; l < networkBody.size(); ++l)
-		for (size_t n = 0; n < networkBody[l].size() - 1; ++n)
-			networkBody[l][n].computeOutput(networkBody[l - 1]);
+		networkBody[l].computeBatchOutputs(workspace[l - 1], workspace[l]);
+	const scalar* results = workspace[networkBody.size() - 1].outputValues.data();
+	for (size_t r = 0; r < count; ++r)
+		std::copy(results + r * networkBody.back().size(), results + r * networkBody.back().size() + outputSize(),
+			outputs + r * outputSize());
+}
+
+/** Computes the outputs for all the records of the set. The records are propagated in batches,
+* which are shared between the threads; the target values of the records are not used.
+* @param set the set of the records
+* @param outputs pointer to the buffer of set.size() * outputSize() values to which the outputs shall be written
+* @param batchSize the number of records propagated at once
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::predictBatch(const myBasicDataSet<scalar>& set, scalar* outputs,
+	size_t batchSize, size_t threadsNumber) const
+{
+	if (set.empty())
+		throw empty_set();
+	if (networkBody.empty() or set.inputSize() != inputSize())
+		throw incompatible_vectors();
+	batchSize = std::max<size_t>(1, batchSize);
+	threadsNumber = std::max<size_t>(1, std::min(threadsNumber, (set.size() + batchSize - 1) / batchSize));
+	myThreadPool pool(threadsNumber);
+	pool.run([&](size_t t) {
+		myBasicWorkspace<scalar> workspace(networkBody.size());
+		for (size_t first = t * batchSize; first < set.size(); first += threadsNumber * batchSize)
+		{
+			size_t count = std::min(batchSize, set.size() - first);
+			computeBatchOutputs(set, first, count, workspace);
+			const scalar* results = workspace.back().outputValues.data();
+			for (size_t r = 0; r < count; ++r)
+				std::copy(results + r * networkBody.back().size(), results + r * networkBody.back().size() + outputSize(),
+					outputs + (first + r) * outputSize());
+		}
+	});
+}
+
+/** Computes the outputs for all the records of the set and writes them to the file.
+* If the extension of the path is ".bin", the outputs are written as raw scalars, record after
+* record; otherwise they are written as text, one record per line.
+* @param set the set of the records
+* @param path the path of the file
+* @param batchSize the number of records propagated at once
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::predictBatch(const myBasicDataSet<scalar>& set, std::string path,
+	size_t batchSize, size_t threadsNumber) const
+{
+	std::vector<scalar> outputs(set.size() * outputSize());
+	predictBatch(set, outputs.data(), batchSize, threadsNumber);
+	std::ofstream file = openPredictions(path);
+	writePredictions(file, extension(path) == ".bin", outputs.data(), set.size(), outputSize());
+	if (not file.good())
+		throw bad_path();
+}
+
+/** Computes the outputs for all the records of the set read from the stream chunk by chunk and
+* writes them to the file, in the same way as for a set held in memory. The stream is rewound first.
+* @param stream the stream of the set
+* @param path the path of the file
+* @param batchSize the number of records propagated at once
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::predictBatch(myBasicDataStream<scalar>& stream, std::string path,
+	size_t batchSize, size_t threadsNumber) const
+{
+	if (networkBody.empty() or stream.inputSize() != inputSize())
+		throw incompatible_vectors();
+	stream.rewind();
+	std::ofstream file = openPredictions(path);
+	bool binary = extension(path) == ".bin", empty = true;
+	std::vector<scalar> outputs;
+	while (const myBasicDataSet<scalar>* chunk = stream.next())
+	{
+		outputs.resize(chunk->size() * outputSize());
+		predictBatch(*chunk, outputs.data(), batchSize, threadsNumber);
+		writePredictions(file, binary, outputs.data(), chunk->size(), outputSize());
+		empty = false;
+	}
+	if (empty)
+		throw empty_set();
+	if (not file.good())
+		throw bad_path();
 }
 
 /** Performs backpropagation.
 * @param targets the vector of target output values
 */
-void myNetwork::backpropagate(std::vector<double> targets)
+template<typename scalar>
+void myBasicNetwork<scalar>::backpropagate(const std::vector<scalar>& targets)
 {
 	if (targets.size() != networkBody.back().size() - 1)
 		throw incompatible_vectors();
-	for (size_t n = 0; n < networkBody.back().size() - 1; ++n)
-		networkBody.back()[n].computeOutputGradient(targets[n]);
+	backpropagate(targets.data());
+}
+
+/** Performs backpropagation.
+* @param targets pointer to outputSize() target output values
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::backpropagate(const scalar* targets)
+{
+	prepareTraining();
+	networkBody.back().computeOutputGradients(targets);
 	for (size_t l = networkBody.size() - 2; l > 0; --l)
-		for (size_t n = 0; n < networkBody[l].size() - 1; ++n)
-			networkBody[l][n].computeHiddenGradient(networkBody[l + 1]);
+		networkBody[l].computeHiddenGradients(networkBody[l + 1]);
 	for (size_t l = networkBody.size() - 1; l > 0; --l)
-		for (size_t n = 0; n < networkBody[l].size() - 1; ++n)
-			networkBody[l][n].improveInputWeights(networkBody[l - 1]);
+		networkBody[l].improveInputWeights(networkBody[l - 1]);
 }
 
 /** Saves the current outputs.
 * @param results the vector to which the values should be saved
 */
-void myNetwork::getResults(std::vector<double>& results)
+template<typename scalar>
+void myBasicNetwork<scalar>::getResults(std::vector<scalar>& results)
 {
-	results.clear();
-	for (size_t n = 0; n < networkBody.back().size() - 1; ++n)
-		results.push_back(networkBody.back()[n].getOutput());
-	results.shrink_to_fit();
+	const myBasicLayer<scalar>& outputLayer = networkBody.back();
+	results.assign(outputLayer.outputs(), outputLayer.outputs() + outputSize());
 }
 
 /** Prints the outputs.
 */
-void myNetwork::printOutputs()
+template<typename scalar>
+void myBasicNetwork<scalar>::printOutputs()
 {
 	std::cout << "The outputs are: " << std::endl;
 	for (size_t n = 0; n < networkBody.back().size() - 1; ++n)
-		std::cout << "[" << n << "] " << networkBody.back()[n].getOutput() << std::endl;
-}
-
-/** Calculates the aggregate square error for current outputs and the target output values.
-* @param targets the vector of target output values for the inputs for which the current outputs have been calculated
-*/
-double myNetwork::AggregateSquareError(const std::vector<double>& targets)
-{
-	if (targets.size() != networkBody.back().size() - 1)
-		throw incompatible_vectors();
-	double error, totalError = 0.0;
-	for (size_t i = 0; i < targets.size(); ++i)
-	{
-		error = (networkBody.back()[i].getOutput() - targets[i]);
-		totalError += error * error;
-	}
-	return totalError;
+		std::cout << "[" << n << "] " << networkBody.back().getOutput(n) << std::endl;
 }
 
 /** Trains the network with the record.
 * @param record the record on which the network shall be trained
 */
-void myNetwork::trainRecord(const myDataRecord& record)
+template<typename scalar>
+void myBasicNetwork<scalar>::trainRecord(const myBasicDataRecord<scalar>& record)
 {
-	propagate(record.inputValues);
-	backpropagate(record.targetValues);
+	if (record.inputValues.size() != inputSize() or record.targetValues.size() != outputSize())
+		throw incompatible_vectors();
+	propagate(record.inputValues.data());
+	backpropagate(record.targetValues.data());
 	if (rand() % 10 == 0)
 		std::cout << ".";
 }
@@ -119,55 +374,412 @@ void myNetwork::trainRecord(const myDataRecord& record)
 /** Trains the network on the data set.
 * @param set the set on which the network shall be trained
 */
-void myNetwork::trainSet(const myDataSet& set)
+template<typename scalar>
+void myBasicNetwork<scalar>::trainSet(const myBasicDataSet<scalar>& set)
 {
+	myPhaseTimer timer(phase::recordTraining, set.size());
 	for (const auto& record : *(set.dataRef()))
 		trainRecord(record);
 }
 
-/** Trains the network on the data set.
-* @param set the set on which the network shall be tested
+/** Performs propagation of a range of records without timing it.
+* @param set the set of the records
+* @param first the index of the first record of the range
+* @param count the number of records in the range
+* @param workspace the batch values of all the layers
+* @param order the indices of the records in the order in which they are visited; if null, the order of the set
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::propagateBatch(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+	myBasicWorkspace<scalar>& workspace, const size_t* order) const
+{
+	for (size_t l = 0; l < networkBody.size(); ++l)
+		networkBody[l].resizeBatch(workspace[l], count);
+	for (size_t r = 0; r < count; ++r)
+		networkBody.front().setBatchInputs(workspace.front(), r, set.inputs(order ? order[first + r] : first + r));
+	for (size_t l = 1; l < networkBody.size(); ++l)
+		networkBody[l].computeBatchOutputs(workspace[l - 1], workspace[l]);
+}
+
+/** Performs backpropagation of a range of records already propagated, without timing it and without improving the weights.
+* @param set the set of the records
+* @param first the index of the first record of the range
+* @param count the number of records in the range
+* @param workspace the batch values of all the layers
+* @param order the indices of the records in the order in which they are visited; if null, the order of the set
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::backpropagateBatch(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+	myBasicWorkspace<scalar>& workspace, const size_t* order) const
+{
+	for (size_t r = 0; r < count; ++r)
+		networkBody.back().computeBatchOutputGradients(workspace.back(), r, set.targets(order ? order[first + r] : first + r));
+	for (size_t l = networkBody.size() - 2; l > 0; --l)
+		networkBody[l].computeBatchHiddenGradients(networkBody[l + 1], workspace[l + 1], workspace[l]);
+}
+
+/** Performs propagation of a range of records.
+* @param set the set of the records
+* @param first the index of the first record of the range
+* @param count the number of records in the range
+* @param workspace the batch values of all the layers
+* @param order the indices of the records in the order in which they are visited; if null, the order of the set
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::computeBatchOutputs(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+	myBasicWorkspace<scalar>& workspace, const size_t* order) const
+{
+	myPhaseTimer timer(phase::propagation, count);
+	propagateBatch(set, first, count, workspace, order);
+}
+
+/** Computes the gradients of the weights summed over a range of records. The propagation is timed as
+* such; the gradients of the outputs and of the weights are timed together as one call of the gradients.
+* @param set the set of the records
+* @param first the index of the first record of the range
+* @param count the number of records in the range
+* @param workspace the batch values of all the layers
+* @param order the indices of the records in the order in which they are visited; if null, the order of the set
 */
-double myNetwork::testSet(const myDataSet& set)
+template<typename scalar>
+void myBasicNetwork<scalar>::computeBatchGradients(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+	myBasicWorkspace<scalar>& workspace, const size_t* order) const
 {
+	computeBatchOutputs(set, first, count, workspace, order);
+	myPhaseTimer timer(phase::gradients, count);
+	backpropagateBatch(set, first, count, workspace, order);
+	for (size_t l = networkBody.size() - 1; l > 0; --l)
+		networkBody[l].computeWeightGradients(workspace[l - 1], workspace[l]);
+}
+
+/** Trains the network on the data set in mini-batches. The weights are improved once per batch.
+* Every batch is split between the threads, each of which computes the gradients of its part
+* in its own buffers. The buffers are then summed pairwise in a fixed tree order, so the result
+* depends only on the batch size and the number of threads.
+* @param set the set on which the network shall be trained
+* @param batchSize the number of records in a batch
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::trainSet(const myBasicDataSet<scalar>& set, size_t batchSize, size_t threadsNumber)
+{
+	if (batchSize <= 1)
+	{
+		trainSet(set);
+		return;
+	}
 	if (set.empty())
 		throw empty_set();
 	if (set.inputSize() != networkBody.front().size() - 1 or
 		set.outputSize() != networkBody.back().size() - 1)
 		throw incompatible_vectors();
-	double error = 0.0;
-	for (const auto& record : *(set.dataRef()))
+	trainEpoch(set, nullptr, batchSize, threadsNumber);
+}
+
+/** Trains the network once on all the records of the set, visited in the order given.
+* Batches of more than one record are trained as by trainSet with the batch size; single records as by trainRecord.
+* @param set the set on which the network shall be trained, compatible with the network
+* @param order the indices of the records in the order in which they are visited; if null, the order of the set
+* @param batchSize the number of records in a batch
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::trainEpoch(const myBasicDataSet<scalar>& set, const size_t* order, size_t batchSize, size_t threadsNumber)
+{
+	if (batchSize <= 1)
 	{
-		propagate(record.inputValues);
-		error += AggregateSquareError(record.targetValues);
+		myPhaseTimer timer(phase::recordTraining, set.size());
+		for (size_t r = 0; r < set.size(); ++r)
+		{
+			size_t record = order ? order[r] : r;
+			propagate(set.inputs(record));
+			backpropagate(set.targets(record));
+		}
+		return;
+	}
+	threadsNumber = std::max<size_t>(1, std::min(threadsNumber, batchSize));
+	prepareTraining();
+	myThreadPool pool(threadsNumber);
+	std::vector<myBasicWorkspace<scalar>> workspaces(threadsNumber,
+		myBasicWorkspace<scalar>(networkBody.size()));
+	for (size_t first = 0; first < set.size(); first += batchSize)
+	{
+		size_t count = std::min(batchSize, set.size() - first);
+		pool.run([&](size_t t) {
+			size_t begin = count * t / threadsNumber, end = count * (t + 1) / threadsNumber;
+			computeBatchGradients(set, first + begin, end - begin, workspaces[t], order);
+		});
+		myPhaseTimer timer(phase::update, count);
+		pool.run([&](size_t t) {
+			for (size_t l = 1; l < networkBody.size(); ++l)
+			{
+				size_t total = networkBody[l].weightsNumber();
+				size_t begin = total * t / threadsNumber, end = total * (t + 1) / threadsNumber;
+				for (size_t stride = 1; stride < threadsNumber; stride *= 2)
+					for (size_t w = 0; w + stride < threadsNumber; w += 2 * stride)
+						axpy(scalar(1), &workspaces[w + stride][l].weightGradients[begin],
+							&workspaces[w][l].weightGradients[begin], end - begin);
+				networkBody[l].improveInputWeights(workspaces[0][l].weightGradients.data(), count, begin, end - begin);
+			}
+		});
 		if (rand() % 10 == 0)
 			std::cout << ".";
 	}
-	return sqrt(error / set.size() / set.outputSize());
+}
+
+/** Trains the network on the data set asynchronously, in the Hogwild style.
+* Every thread trains on its share of the records one by one, exactly like trainRecord, but in its
+* own workspace, and improves the shared weights without any locking. The races between the
+* updates of different threads are tolerated: an update may occasionally be lost or computed
+* from slightly stale weights, which does not hinder convergence when the updates are sparse
+* compared to the number of weights. The result is not deterministic.
+* @param set the set on which the network shall be trained
+* @param threadsNumber the number of threads
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::trainSetAsync(const myBasicDataSet<scalar>& set, size_t threadsNumber)
+{
+	if (set.empty())
+		throw empty_set();
+	if (set.inputSize() != networkBody.front().size() - 1 or
+		set.outputSize() != networkBody.back().size() - 1)
+		throw incompatible_vectors();
+	threadsNumber = std::max<size_t>(1, std::min(threadsNumber, set.size()));
+	prepareTraining();
+	myThreadPool pool(threadsNumber);
+	pool.run([&](size_t t) {
+		myBasicWorkspace<scalar> workspace(networkBody.size());
+		myPhaseTimer timer(phase::recordTraining, (set.size() - t + threadsNumber - 1) / threadsNumber);
+		for (size_t r = t; r < set.size(); r += threadsNumber)
+		{
+			propagateBatch(set, r, 1, workspace);
+			backpropagateBatch(set, r, 1, workspace);
+			for (size_t l = networkBody.size() - 1; l > 0; --l)
+				networkBody[l].improveInputWeights(workspace[l - 1], workspace[l]);
+			if (t == 0 and rand() % 10 == 0)
+				std::cout << ".";
+		}
+	});
+}
+
+/** Trains the network for a number of epochs, testing it on the validation set after every one.
+* In every epoch the records are visited in a new random order, through a permutation of their indices.
+* The training stops early once the validation error has not improved by more than options.minimalImprovement
+* for options.patience epochs (0 never stops it), and the weights of the best epoch are then restored.
+* If options.checkpointPath is given (.net or .netb), the network is saved there every options.checkpointInterval
+* epochs by a background thread, from a copy of the weights, while the training goes on. When the weights of
+* the best epoch are restored, they are saved there once more, so that the file holds the weights kept.
+* @param trainingSet the set on which the network shall be trained
+* @param validationSet the set on which the network shall be tested after every epoch
+* @param epochs the maximal number of epochs
+* @param options the settings of the training
+* @return the validation errors of the epochs, as computed by testSet
+*/
+template<typename scalar>
+std::vector<double> myBasicNetwork<scalar>::fit(const myBasicDataSet<scalar>& trainingSet,
+	const myBasicDataSet<scalar>& validationSet, size_t epochs, const fit_options& options)
+{
+	if (trainingSet.empty() or validationSet.empty())
+		throw empty_set();
+	if (trainingSet.inputSize() != inputSize() or trainingSet.outputSize() != outputSize()
+		or validationSet.inputSize() != inputSize() or validationSet.outputSize() != outputSize())
+		throw incompatible_vectors();
+	std::string type = extension(options.checkpointPath);
+	if (not options.checkpointPath.empty() and type != ".net" and type != ".netb")
+		throw bad_extension(filetype::net);
+	std::vector<size_t> order(trainingSet.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::mt19937 generator(rand());
+	std::vector<double> errors;
+	std::vector<myBasicLayer<scalar>> bestLayers;
+	double bestError = std::numeric_limits<double>::infinity();
+	size_t bestEpoch = 0;
+	std::future<void> checkpoint;
+	auto saveCheckpoint = [&]() {
+		if (checkpoint.valid())
+			checkpoint.get();
+		myBasicNetwork snapshot;
+		snapshot.networkBody = networkBody;
+		checkpoint = std::async(std::launch::async, [snapshot = std::move(snapshot), path = options.checkpointPath, type]() mutable {
+			if (type == ".netb")
+			{
+				snapshot.saveBinary(path);
+				return;
+			}
+			std::string temporaryPath = path + ".tmp";
+			snapshot.saveNetwork(temporaryPath);
+			if (std::rename(temporaryPath.c_str(), path.c_str()) != 0
+				and (std::remove(path.c_str()) != 0 or std::rename(temporaryPath.c_str(), path.c_str()) != 0))
+			{
+				std::remove(temporaryPath.c_str());
+				throw bad_path();
+			}
+		});
+	};
+	for (size_t epoch = 0; epoch < epochs; ++epoch)
+	{
+		if (options.shuffle)
+			std::shuffle(order.begin(), order.end(), generator);
+		trainEpoch(trainingSet, order.data(), options.batchSize, options.threadsNumber);
+		errors.push_back(testSet(validationSet));
+		if (options.report)
+			options.report(epoch + 1, errors.back());
+		if (errors.back() < bestError - options.minimalImprovement)
+		{
+			bestError = errors.back();
+			bestEpoch = epoch;
+			if (options.patience != 0)
+				bestLayers = networkBody;
+		}
+		if (not options.checkpointPath.empty() and (epoch + 1) % std::max<size_t>(1, options.checkpointInterval) == 0)
+			saveCheckpoint();
+		if (options.patience != 0 and epoch - bestEpoch >= options.patience)
+			break;
+	}
+	if (not bestLayers.empty() and bestEpoch + 1 < errors.size())
+	{
+		networkBody = std::move(bestLayers);
+		if (not options.checkpointPath.empty())
+			saveCheckpoint();
+	}
+	if (checkpoint.valid())
+		checkpoint.get();
+	return errors;
+}
+
+/** Tests the network on the data set. The network is not changed.
+* @param set the set on which the network shall be tested
+*/
+template<typename scalar>
+double myBasicNetwork<scalar>::testSet(const myBasicDataSet<scalar>& set) const
+{
+	if (set.empty())
+		throw empty_set();
+	return sqrt(totalSquareError(set) / set.size() / set.outputSize());
+}
+
+/** Sums the aggregate square errors over all the records of the data set. The records are propagated
+* in batches in a workspace of the call.
+* @param set the set on which the network shall be tested
+*/
+template<typename scalar>
+double myBasicNetwork<scalar>::totalSquareError(const myBasicDataSet<scalar>& set) const
+{
+	if (set.inputSize() != networkBody.front().size() - 1 or
+		set.outputSize() != networkBody.back().size() - 1)
+		throw incompatible_vectors();
+	const size_t batchSize = 256;
+	myBasicWorkspace<scalar> workspace(networkBody.size());
+	double error = 0.0;
+	for (size_t first = 0; first < set.size(); first += batchSize)
+	{
+		size_t count = std::min(batchSize, set.size() - first);
+		computeBatchOutputs(set, first, count, workspace);
+		const scalar* results = workspace.back().outputValues.data();
+		for (size_t r = 0; r < count; ++r)
+		{
+			const scalar* targets = set.targets(first + r);
+			for (size_t i = 0; i < outputSize(); ++i)
+			{
+				double difference = double(results[r * networkBody.back().size() + i]) - targets[i];
+				error += difference * difference;
+			}
+			if (rand() % 10 == 0)
+				std::cout << ".";
+		}
+	}
+	return error;
+}
+
+/** Trains the network on the data set read from the stream chunk by chunk. The stream is rewound first.
+* @param stream the stream of the set on which the network shall be trained
+* @param batchSize the number of records in a batch; batches do not span chunks
+* @param threadsNumber the number of threads sharing the work
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::trainSet(myBasicDataStream<scalar>& stream, size_t batchSize, size_t threadsNumber)
+{
+	if (stream.inputSize() != inputSize() or stream.outputSize() != outputSize())
+		throw incompatible_vectors();
+	stream.rewind();
+	bool empty = true;
+	while (const myBasicDataSet<scalar>* chunk = stream.next())
+	{
+		trainSet(*chunk, batchSize, threadsNumber);
+		empty = false;
+	}
+	if (empty)
+		throw empty_set();
+}
+
+/** Tests the network on the data set read from the stream chunk by chunk. The stream is rewound first.
+* @param stream the stream of the set on which the network shall be tested
+*/
+template<typename scalar>
+double myBasicNetwork<scalar>::testSet(myBasicDataStream<scalar>& stream) const
+{
+	if (stream.inputSize() != inputSize() or stream.outputSize() != outputSize())
+		throw incompatible_vectors();
+	stream.rewind();
+	double error = 0.0;
+	size_t recordsNumber = 0;
+	while (const myBasicDataSet<scalar>* chunk = stream.next())
+	{
+		error += totalSquareError(*chunk);
+		recordsNumber += chunk->size();
+	}
+	if (recordsNumber == 0)
+		throw empty_set();
+	return sqrt(error / recordsNumber / stream.outputSize());
 }
 
 /** Creates the network according to the layout.
 * @param layout the vector defining the network's structure
+* @param activations the activation functions of the layers, the first of which is not used; if empty, all the layers use tanh
 */
-void myNetwork::create(const std::vector<size_t>& layout)
+template<typename scalar>
+void myBasicNetwork<scalar>::create(const std::vector<size_t>& layout, const std::vector<activation>& activations)
 {
+	if (not activations.empty() and activations.size() != layout.size())
+		throw incompatible_vectors();
+	for (size_t l = 1; l + 1 < activations.size(); ++l)
+		if (activations[l] == activation::softmax)
+			throw incorrect_contents();
+	networkBody.reserve(layout.size());
 	for (size_t l = 0; l < layout.size(); ++l)
-	{
-		networkBody.push_back(std::vector<myNeuron>());
-		for (size_t n = 0; n <= layout[l]; ++n)
-			networkBody.back().push_back(myNeuron(l == 0 or n == layout[l] ? 0 : layout[l - 1] + 1, n));
-		networkBody.back().shrink_to_fit();
-	}
-	networkBody.shrink_to_fit();
+		networkBody.push_back(myBasicLayer<scalar>(layout[l], l == 0 ? 0 : layout[l - 1] + 1,
+			activations.empty() ? activation::tanh : activations[l]));
+}
+
+/** Tells whether the other network has the same numbers of neurons and activation functions in all the layers,
+* so that either can take the place of the other.
+* @param other the network to be compared
+*/
+template<typename scalar>
+bool myBasicNetwork<scalar>::sameLayout(const myBasicNetwork& other) const
+{
+	if (networkBody.size() != other.networkBody.size())
+		return false;
+	for (size_t l = 0; l < networkBody.size(); ++l)
+		if (networkBody[l].size() != other.networkBody[l].size()
+			or (l != 0 and networkBody[l].getActivation() != other.networkBody[l].getActivation()))
+			return false;
+	return true;
 }
 
 /** Reads the network from the path.
 * @param path the path from which the network shall be read
 */
-void myNetwork::read(std::string path)
+template<typename scalar>
+void myBasicNetwork<scalar>::read(std::string path)
 {
 	std::ifstream source;
 	std::string type = extension(path);
+	if (type == ".netb")
+	{
+		readBinary(path);
+		return;
+	}
 	if (type == ".lay" or type == ".net")
 		source.open(path, std::ios::in);
 	else
@@ -202,14 +814,31 @@ void myNetwork::read(std::string path)
 			throw incorrect_contents();
 		}
 	}
-	create(layerSizes);
+	std::vector<activation> activations(networkSize, activation::tanh);
+	source >> std::ws;
+	if (isalpha(source.peek()))
+		for (size_t l = 1; l < networkSize; ++l)
+		{
+			std::string name;
+			if (not (source >> name))
+			{
+				source.close();
+				throw incomplete_contents();
+			}
+			if (not parseActivation(name, activations[l]) or (activations[l] == activation::softmax and l + 1 < networkSize))
+			{
+				source.close();
+				throw incorrect_contents();
+			}
+		}
+	create(layerSizes, activations);
 	layerSizes.clear();
 	if (type == ".lay")
 	{
 		source.close();
 		return;
 	}
-	std::vector<double> weights;
+	std::vector<scalar> weights;
 	for (size_t l = 1; l < networkBody.size(); ++l)
 	{
 		weights.resize(networkBody[l - 1].size());
@@ -221,7 +850,7 @@ void myNetwork::read(std::string path)
 					source.close();
 					throw incomplete_contents();
 				}
-			networkBody[l][n].setInputWeights(weights);
+			networkBody[l].setInputWeights(n, weights);
 		}
 	}
 	source.close();
@@ -230,7 +859,8 @@ void myNetwork::read(std::string path)
 /** Saves the layout of the network on the path given.
 * @param path the path on which the network shall be saved
 */
-void myNetwork::saveLayout(std::string path)
+template<typename scalar>
+void myBasicNetwork<scalar>::saveLayout(std::string path)
 {
 	std::ofstream file;
 	file.open(path, std::ios::out);
@@ -242,13 +872,32 @@ void myNetwork::saveLayout(std::string path)
 	file << networkBody.size() << '\n';
 	for (size_t l = 0; l < networkBody.size(); ++l)
 		file << networkBody[l].size() - 1 << ' ';
+	saveActivations(file);
 	file.close();
 }
 
+/** Writes the names of the activation functions of the layers following the input one.
+* Nothing is written if all of them use tanh, so that such networks are saved as before.
+* @param file the stream to which the names shall be written
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::saveActivations(std::ostream& file) const
+{
+	bool custom = false;
+	for (size_t l = 1; l < networkBody.size(); ++l)
+		custom = custom or networkBody[l].getActivation() != activation::tanh;
+	if (not custom)
+		return;
+	file << '\n';
+	for (size_t l = 1; l < networkBody.size(); ++l)
+		file << activationName(networkBody[l].getActivation()) << ' ';
+}
+
 /** Saves the network (with the weights) on the path given.
 * @param path the path on which the network shall be saved
 */
-void myNetwork::saveNetwork(std::string path)
+template<typename scalar>
+void myBasicNetwork<scalar>::saveNetwork(std::string path)
 {
 	std::ofstream file;
 	file.open(path, std::ios::out);
@@ -260,13 +909,14 @@ void myNetwork::saveNetwork(std::string path)
 	file << networkBody.size() << '\n';
 	for (size_t l = 0; l < networkBody.size(); ++l)
 		file << networkBody[l].size() - 1 << ' ';
+	saveActivations(file);
 	file << '\n' << '\n';
 	for (size_t l = 1; l < networkBody.size(); ++l)
 	{
 		for (size_t n = 0; n < networkBody[l].size() - 1; ++n)
 		{
 			for (size_t w = 0; w < networkBody[l - 1].size(); ++w)
-				file << networkBody[l][n].getWeight(w) << ' ';
+				file << networkBody[l].getWeight(n, w) << ' ';
 			file << '\n';
 		}
 		file << '\n';
@@ -274,11 +924,134 @@ void myNetwork::saveNetwork(std::string path)
 	file.close();
 }
 
+/** Reads the network from a binary file. The file is mapped into memory and the weights are
+* used in place; they are copied page by page only when the network is trained.
+* @param path the path from which the network shall be read
+* @param verify whether the checksum shall be verified, which requires reading the whole file
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::readBinary(std::string path, bool verify)
+{
+	if (extension(path) != ".netb")
+		throw bad_extension(filetype::net);
+	auto file = std::make_shared<myMappedFile>(path);
+	netb_header header;
+	if (file->size() < sizeof(header))
+		throw incomplete_contents();
+	memcpy(&header, file->data(), sizeof(header));
+	if (memcmp(header.magic, netbMagic, sizeof(netbMagic)) != 0 or header.endianness != netbEndianness
+		or header.version == 0 or header.version > netbVersion or header.scalarSize != sizeof(scalar)
+		or header.layersNumber == 0)
+		throw incorrect_contents();
+	size_t arraysNumber = header.version == 1 ? 1 : 2;
+	// The sizes are compared with the file by divisions, so that no product or sum of them overflows.
+	if (header.layersNumber > (file->size() - sizeof(header)) / (arraysNumber * sizeof(uint64_t)))
+		throw incomplete_contents();
+	size_t offset = sizeof(header) + arraysNumber * size_t(header.layersNumber) * sizeof(uint64_t);
+	std::vector<size_t> layerSizes(header.layersNumber);
+	std::vector<activation> activations(header.layersNumber, activation::tanh);
+	for (size_t l = 0; l < layerSizes.size(); ++l)
+	{
+		uint64_t layerSize;
+		memcpy(&layerSize, file->data() + sizeof(header) + l * sizeof(uint64_t), sizeof(uint64_t));
+		if (layerSize == 0)
+			throw incorrect_contents();
+		if (layerSize > file->size())
+			throw incomplete_contents();
+		layerSizes[l] = size_t(layerSize);
+		if (arraysNumber == 2)
+		{
+			uint64_t function;
+			memcpy(&function, file->data() + sizeof(header) + (layerSizes.size() + l) * sizeof(uint64_t), sizeof(uint64_t));
+			if (function > uint64_t(activation::softmax) or (activation(function) == activation::softmax and l + 1 < layerSizes.size()))
+				throw incorrect_contents();
+			activations[l] = activation(function);
+		}
+	}
+	std::vector<size_t> offsets(layerSizes.size(), 0);
+	offset = aligned(offset);
+	for (size_t l = 1; l < layerSizes.size(); ++l)
+	{
+		if (offset > file->size() or layerSizes[l] > (file->size() - offset) / sizeof(scalar) / (layerSizes[l - 1] + 1))
+			throw incomplete_contents();
+		offsets[l] = offset;
+		offset = aligned(offset + layerSizes[l] * (layerSizes[l - 1] + 1) * sizeof(scalar));
+	}
+	if (file->size() < offset)
+		throw incomplete_contents();
+	if (verify and checksum(checksumBasis, file->data() + sizeof(header), offset - sizeof(header)) != header.checksum)
+		throw incorrect_contents();
+	clear();
+	networkBody.reserve(layerSizes.size());
+	for (size_t l = 0; l < layerSizes.size(); ++l)
+		networkBody.push_back(myBasicLayer<scalar>(layerSizes[l], l == 0 ? 0 : layerSizes[l - 1] + 1,
+			l == 0 ? nullptr : reinterpret_cast<scalar*>(file->data() + offsets[l]), activations[l]));
+	mapping = file;
+}
+
+/** Saves the network (with the weights) in the binary format on the path given.
+* The file is written under a temporary name and then renamed, so that a network mapped from the path stays valid.
+* @param path the path on which the network shall be saved
+*/
+template<typename scalar>
+void myBasicNetwork<scalar>::saveBinary(std::string path)
+{
+	std::string temporaryPath = path + ".tmp";
+	std::ofstream file;
+	file.open(temporaryPath, std::ios::out | std::ios::binary);
+	if (not file.good())
+	{
+		file.close();
+		throw bad_path();
+	}
+	netb_header header;
+	memcpy(header.magic, netbMagic, sizeof(netbMagic));
+	header.endianness = netbEndianness;
+	header.version = netbVersion;
+	header.scalarSize = sizeof(scalar);
+	header.layersNumber = networkBody.size();
+	std::vector<uint64_t> layerSizes((aligned(sizeof(header) + 2 * networkBody.size() * sizeof(uint64_t))
+		- sizeof(header)) / sizeof(uint64_t), 0);
+	for (size_t l = 0; l < networkBody.size(); ++l)
+	{
+		layerSizes[l] = networkBody[l].size() - 1;
+		layerSizes[networkBody.size() + l] = uint64_t(networkBody[l].getActivation());
+	}
+	const std::vector<char> padding(blockAlignment, 0);
+	auto sections = [&](auto&& consume) {
+		consume(reinterpret_cast<const char*>(layerSizes.data()), layerSizes.size() * sizeof(uint64_t));
+		for (size_t l = 1; l < networkBody.size(); ++l)
+		{
+			size_t length = networkBody[l].weightsNumber() * sizeof(scalar);
+			consume(reinterpret_cast<const char*>(networkBody[l].weightValues()), length);
+			consume(padding.data(), aligned(length) - length);
+		}
+	};
+	header.checksum = checksumBasis;
+	sections([&](const char* data, size_t length) { header.checksum = checksum(header.checksum, data, length); });
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	sections([&](const char* data, size_t length) { file.write(data, length); });
+	bool written = file.good();
+	file.close();
+	if (written and std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+		written = std::remove(path.c_str()) == 0 and std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+	if (not written)
+	{
+		std::remove(temporaryPath.c_str());
+		throw bad_path();
+	}
+}
+
+template class myBasicNetwork<float>;
+template class myBasicNetwork<double>;
+
 const char* bad_extension::what()
 {
 	
 	if (type == filetype::net)
-		return "Invalid extension. Acceptable are \".lay\" and \".net\".";
+		return "Invalid extension. Acceptable are \".lay\", \".net\" and \".netb\".";
+	else if (type == filetype::quantized)
+		return "Invalid extension. Acceptable is \".netq\".";
 	else 
 		return "Invalid extension. Acceptable is \".set\".";
 }
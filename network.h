@@ -1,13 +1,16 @@
 /**@file*/
 
 #pragma once
-#include "neuron.h"
+#include "layer.h"
+#include "mapping.h"
 #include "training.h"
+#include <functional>
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 
-enum class filetype { net, set };
+enum class filetype { net, set, quantized };
 class bad_extension : public std::exception
 {
 	filetype type;
@@ -15,43 +18,109 @@ public:
 	bad_extension(filetype _type) : type(_type) {}
 	const char* what();
 };
-class no_file              : public std::exception { const char* what(); };
-class incorrect_contents   : public std::exception { const char* what(); };
-class incomplete_contents  : public std::exception { const char* what(); };
-class bad_path             : public std::exception { const char* what(); };
-class incompatible_vectors : public std::exception { const char* what(); };
-class empty_set            : public std::exception { const char* what(); };
+class no_file              : public std::exception { public: const char* what(); };
+class incorrect_contents   : public std::exception { public: const char* what(); };
+class incomplete_contents  : public std::exception { public: const char* what(); };
+class bad_path             : public std::exception { public: const char* what(); };
+class incompatible_vectors : public std::exception { public: const char* what(); };
+class empty_set            : public std::exception { public: const char* what(); };
 
-struct myDataRecord;
-class myDataSet;
+/** The settings of myBasicNetwork::fit.
+*/
+struct fit_options
+{
+	size_t batchSize = 1, threadsNumber = 1;
+	bool shuffle = true;
+	size_t patience = 5;
+	double minimalImprovement = 0.0;
+	std::string checkpointPath;
+	size_t checkpointInterval = 1;
+	std::function<void(size_t, double)> report;
+};
+
+template<typename scalar> struct myBasicDataRecord;
+template<typename scalar> class myBasicDataSet;
+template<typename scalar> class myBasicDataStream;
 
-class myNetwork
+/** The values of all the layers of a network computed on one thread. The network is only read while it
+* infers into a workspace, so many threads may infer with one network at once, each into its own workspace.
+*/
+template<typename scalar>
+using myBasicWorkspace = std::vector<myBasicBatchValues<scalar>>;
+
+using myWorkspace = myBasicWorkspace<double>;
+
+/** A network of layers, whose weights and values are of the scalar type, either float or double.
+* The errors are always accumulated in double.
+*/
+template<typename scalar>
+class myBasicNetwork
 {
-	std::vector<std::vector<myNeuron>> networkBody;
-	double AggregateSquareError(const std::vector<double>& targets);
+	std::vector<myBasicLayer<scalar>> networkBody;
+	std::shared_ptr<myMappedFile> mapping;
+	void prepareTraining();
+	double totalSquareError(const myBasicDataSet<scalar>& set) const;
+	void propagateRecords(const scalar* inputs, size_t count, scalar* outputs, myBasicWorkspace<scalar>& workspace) const;
+	void propagateBatch(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+		myBasicWorkspace<scalar>& workspace, const size_t* order = nullptr) const;
+	void backpropagateBatch(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+		myBasicWorkspace<scalar>& workspace, const size_t* order = nullptr) const;
+	void computeBatchOutputs(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+		myBasicWorkspace<scalar>& workspace, const size_t* order = nullptr) const;
+	void computeBatchGradients(const myBasicDataSet<scalar>& set, size_t first, size_t count,
+		myBasicWorkspace<scalar>& workspace, const size_t* order = nullptr) const;
+	void trainEpoch(const myBasicDataSet<scalar>& set, const size_t* order, size_t batchSize, size_t threadsNumber);
+	void saveActivations(std::ostream& file) const;
 
 public:
-	myNetwork() {}
-	myNetwork(const std::vector<size_t>& layout) { create(layout); }
+	myBasicNetwork() {}
+	myBasicNetwork(const std::vector<size_t>& layout, const std::vector<activation>& activations = {}) { create(layout, activations); }
 	void printNet();
 
-	void propagate(std::vector<double> inputs);
-	void backpropagate(std::vector<double> targets);
+	void propagate(const scalar* inputs);
+	void propagate(const std::vector<scalar>& inputs);
+	void backpropagate(const scalar* targets);
+	void backpropagate(const std::vector<scalar>& targets);
+	void infer(const scalar* inputs, size_t size, scalar* outputs) const;
+	void infer(const scalar* inputs, size_t size, scalar* outputs, myBasicWorkspace<scalar>& workspace) const;
+	void inferBatch(const scalar* inputs, size_t count, scalar* outputs, myBasicWorkspace<scalar>& workspace) const;
+	void predictBatch(const myBasicDataSet<scalar>& set, scalar* outputs, size_t batchSize = 256, size_t threadsNumber = 1) const;
+	void predictBatch(const myBasicDataSet<scalar>& set, std::string path, size_t batchSize = 256, size_t threadsNumber = 1) const;
+	void predictBatch(myBasicDataStream<scalar>& stream, std::string path, size_t batchSize = 256, size_t threadsNumber = 1) const;
 	
-	void getResults(std::vector<double>& results);
+	void getResults(std::vector<scalar>& results);
 	void printOutputs();
 	
-	void trainRecord(const myDataRecord& record);
-	void trainSet(const myDataSet& set);
-	double testSet(const myDataSet& set);
+	void trainRecord(const myBasicDataRecord<scalar>& record);
+	void trainSet(const myBasicDataSet<scalar>& set);
+	void trainSet(const myBasicDataSet<scalar>& set, size_t batchSize, size_t threadsNumber = 1);
+	void trainSetAsync(const myBasicDataSet<scalar>& set, size_t threadsNumber);
+	double testSet(const myBasicDataSet<scalar>& set) const;
+	void trainSet(myBasicDataStream<scalar>& stream, size_t batchSize = 1, size_t threadsNumber = 1);
+	double testSet(myBasicDataStream<scalar>& stream) const;
+	std::vector<double> fit(const myBasicDataSet<scalar>& trainingSet, const myBasicDataSet<scalar>& validationSet,
+		size_t epochs, const fit_options& options = fit_options());
 	
 	bool empty() { return networkBody.empty(); }
-	void create(const std::vector<size_t>& layout);
-	void clear() { networkBody.clear(); }
+	void create(const std::vector<size_t>& layout, const std::vector<activation>& activations = {});
+	bool sameLayout(const myBasicNetwork& other) const;
+	void clear() { networkBody.clear(); mapping.reset(); }
 	
 	void read(std::string path);
+	void readBinary(std::string path, bool verify = true);
 	void saveLayout(std::string path);
 	void saveNetwork(std::string path);
+	void saveBinary(std::string path);
 
 	size_t inputSize() const { return (networkBody.empty() ? 0 : networkBody.front().size() - 1); }
+	size_t outputSize() const { return (networkBody.empty() ? 0 : networkBody.back().size() - 1); }
+	const std::vector<myBasicLayer<scalar>>& layers() const { return networkBody; }
+	void setInputWeights(size_t layer, size_t neuron, const std::vector<scalar>& values)
+	{
+		if (layer == 0 or layer >= networkBody.size())
+			throw out_of_range();
+		networkBody[layer].setInputWeights(neuron, values);
+	}
 };
+
+using myNetwork = myBasicNetwork<double>;
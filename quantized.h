@@ -0,0 +1,54 @@
+/**@file*/
+
+#pragma once
+#include "network.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** A layer with the weights quantized to 8 bits. Every row has its own scale, chosen so that its
+* largest weight maps to 127. The bias weights are kept apart as floats.
+*/
+struct quantized_layer
+{
+	size_t neuronsNumber, inputsNumber;
+	activation function;
+	std::vector<int8_t> weights;
+	std::vector<float> scales, biases;
+};
+
+/** A network quantized after training, used only for inference.
+* The inputs of every layer are quantized to 8 bits as well, scaled record by record by their
+* largest magnitude, and the products are accumulated in 32-bit integers. The activation
+* functions are computed in single precision; tanh is interpolated from a table.
+*/
+class myQuantizedNetwork
+{
+	std::vector<quantized_layer> networkBody;
+	std::vector<int8_t> inputBuffer;
+	std::vector<float> valueBuffer;
+
+	void allocateBuffers();
+
+public:
+	myQuantizedNetwork() {}
+	template<typename scalar>
+	myQuantizedNetwork(const myBasicNetwork<scalar>& network) { quantize(network); }
+
+	template<typename scalar>
+	void quantize(const myBasicNetwork<scalar>& network);
+	template<typename scalar>
+	void infer(const scalar* inputs, size_t size, scalar* outputs);
+	template<typename scalar>
+	double testSet(const myBasicDataSet<scalar>& set);
+	template<typename scalar>
+	double compare(const myBasicNetwork<scalar>& network, const myBasicDataSet<scalar>& set);
+
+	bool empty() const { return networkBody.empty(); }
+	void clear() { networkBody.clear(); }
+	void read(std::string path);
+	void save(std::string path);
+
+	size_t inputSize() const { return (networkBody.empty() ? 0 : networkBody.front().inputsNumber - 1); }
+	size_t outputSize() const { return (networkBody.empty() ? 0 : networkBody.back().neuronsNumber); }
+};
@@ -0,0 +1,96 @@
+/**@file*/
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** A set of named entities shared between threads. The names are hashed; the entities are held by
+* shared pointers, so that an entity found stays alive while it is used, even if it is removed from
+* the registry in the meantime. The registry itself is guarded by a reader-writer lock; every entity
+* guards its own contents.
+*/
+template<typename entity>
+class myRegistry
+{
+	mutable std::shared_mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<entity>> entries;
+
+public:
+	/** Returns the entity of the name, or a null pointer if there is none.
+	*/
+	std::shared_ptr<entity> find(const std::string& name) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		auto entry = entries.find(name);
+		return entry == entries.end() ? nullptr : entry->second;
+	}
+
+	bool contains(const std::string& name) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return entries.count(name) != 0;
+	}
+
+	/** Adds the entity under the name unless the name is already taken.
+	* @return whether the entity has been added
+	*/
+	bool insert(const std::string& name, std::shared_ptr<entity> item)
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		return entries.emplace(name, std::move(item)).second;
+	}
+
+	/** Puts the entity in place of the expected one under the name. Those who have found the expected
+	* entity before keep it until they release it; those who look for the name afterwards find the new one.
+	* @return whether the entity has been replaced; it is not if the name has been removed or given
+	* to another entity in the meantime
+	*/
+	bool replace(const std::string& name, const std::shared_ptr<entity>& expected, std::shared_ptr<entity> item)
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto entry = entries.find(name);
+		if (entry == entries.end() or entry->second != expected)
+			return false;
+		entry->second = std::move(item);
+		return true;
+	}
+
+	/** Removes the entity of the name from the registry.
+	* @return the entity removed, or a null pointer if there was none
+	*/
+	std::shared_ptr<entity> remove(const std::string& name)
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto entry = entries.find(name);
+		if (entry == entries.end())
+			return nullptr;
+		std::shared_ptr<entity> item = std::move(entry->second);
+		entries.erase(entry);
+		return item;
+	}
+
+	/** Returns the names and the entities, sorted by the names.
+	*/
+	std::vector<std::pair<std::string, std::shared_ptr<entity>>> list() const
+	{
+		std::vector<std::pair<std::string, std::shared_ptr<entity>>> items;
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			items.assign(entries.begin(), entries.end());
+		}
+		std::sort(items.begin(), items.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+		return items;
+	}
+
+	bool empty() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return entries.empty();
+	}
+};
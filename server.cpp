@@ -0,0 +1,358 @@
+#include "server.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#ifdef _WIN32
+/** The server is not available on Windows; it never listens.
+*/
+void myServer::start(std::string, const server_options&)
+{
+	throw bad_path();
+}
+
+/** Does nothing, because the server never runs on Windows.
+*/
+void myServer::stop()
+{
+}
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+	/** The longest line a client may send; a connection sending a longer one is answered with an error and closed.
+	*/
+	const size_t maxLineLength = 1 << 20;
+
+	bool isWhite(char c)
+	{
+		return c == ' ' or c == '\t' or c == '\r';
+	}
+
+	const char* skipWhite(const char* begin, const char* end)
+	{
+		while (begin != end and isWhite(*begin))
+			++begin;
+		return begin;
+	}
+
+	/** Sends the whole text, unless the connection is broken.
+	*/
+	bool sendAll(int socket, const std::string& text)
+	{
+		size_t sent = 0;
+		while (sent < text.size())
+		{
+			ssize_t result = send(socket, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+			if (result <= 0)
+				return false;
+			sent += size_t(result);
+		}
+		return true;
+	}
+
+	/** Tells whether the address is a TCP port, made of digits only, rather than the path of a Unix domain socket.
+	*/
+	bool isPort(const std::string& address)
+	{
+		return not address.empty() and std::all_of(address.begin(), address.end(),
+			[](char c) { return isdigit(static_cast<unsigned char>(c)); });
+	}
+}
+
+/** Starts listening at the address and starts the workers.
+* @param address the number of a TCP port on the local host, or the path of a Unix domain socket, which is replaced if it exists
+* @param _options the settings of the batching
+*/
+void myServer::start(std::string address, const server_options& _options)
+{
+	if (running)
+		stop();
+	options = _options;
+	options.maxBatch = std::max<size_t>(1, options.maxBatch);
+	options.workersNumber = std::max<size_t>(1, options.workersNumber);
+	if (isPort(address))
+	{
+		unsigned long port = std::stoul(address);
+		if (port == 0 or port > 65535)
+			throw bad_path();
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		if (listener < 0)
+			throw bad_path();
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in local = {};
+		local.sin_family = AF_INET;
+		local.sin_port = htons(uint16_t(port));
+		local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+		{
+			close(listener);
+			listener = -1;
+			throw bad_path();
+		}
+	}
+	else
+	{
+		sockaddr_un local = {};
+		if (address.size() >= sizeof(local.sun_path))
+			throw bad_path();
+		local.sun_family = AF_UNIX;
+		strcpy(local.sun_path, address.c_str());
+		unlink(address.c_str());
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0 or bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+		{
+			if (listener >= 0)
+				close(listener);
+			listener = -1;
+			throw bad_path();
+		}
+		socketPath = address;
+	}
+	if (listen(listener, SOMAXCONN) != 0)
+	{
+		stop();
+		throw bad_path();
+	}
+	stopping = false;
+	running = true;
+	for (size_t w = 0; w < options.workersNumber; ++w)
+		workers.emplace_back(&myServer::work, this);
+	acceptor = std::thread(&myServer::accept, this);
+}
+
+/** Stops accepting the connections, closes the open ones, waits for the requests already received to be
+* answered and stops the workers.
+*/
+void myServer::stop()
+{
+	running = false;
+	if (listener >= 0)
+		shutdown(listener, SHUT_RDWR);
+	if (acceptor.joinable())
+		acceptor.join();
+	if (listener >= 0)
+		close(listener);
+	listener = -1;
+	if (not socketPath.empty())
+		unlink(socketPath.c_str());
+	socketPath.clear();
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		for (auto& client : connections)
+			shutdown(client->socket, SHUT_RDWR);
+	}
+	for (auto& client : connections)
+	{
+		client->reader.join();
+		close(client->socket);
+	}
+	connections.clear();
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+/** The loop of the thread accepting the connections. The connections which have been closed are
+* forgotten at every new one.
+*/
+void myServer::accept()
+{
+	while (running)
+	{
+		int client = ::accept(listener, nullptr, nullptr);
+		if (client < 0)
+		{
+			if (errno == EINTR or errno == ECONNABORTED)
+				continue;
+			return;
+		}
+		int noDelay = 1;
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		connections.remove_if([](const std::unique_ptr<connection>& old)
+			{
+				if (not old->finished)
+					return false;
+				old->reader.join();
+				close(old->socket);
+				return true;
+			});
+		if (not running)
+		{
+			close(client);
+			return;
+		}
+		connections.push_back(std::make_unique<connection>(client));
+		connection& added = *connections.back();
+		added.reader = std::thread(&myServer::serve, this, std::ref(added));
+	}
+}
+
+/** The loop of the thread reading a connection. All the complete lines received at once are submitted
+* before the answers are awaited, so that the requests of one client may share a batch. A line longer
+* than maxLineLength is answered with an error, and the connection is closed.
+* @param client the connection
+*/
+void myServer::serve(connection& client)
+{
+	std::string received, answers;
+	std::vector<std::future<std::string>> pending;
+	char buffer[1 << 16];
+	while (true)
+	{
+		ssize_t length = recv(client.socket, buffer, sizeof(buffer), 0);
+		if (length <= 0)
+			break;
+		received.append(buffer, size_t(length));
+		size_t begin = 0, end;
+		while ((end = received.find('\n', begin)) != std::string::npos)
+		{
+			pending.push_back(submit(received.data() + begin, received.data() + end));
+			begin = end + 1;
+		}
+		received.erase(0, begin);
+		answers.clear();
+		for (auto& answer : pending)
+			answers += answer.get();
+		pending.clear();
+		bool tooLong = received.size() > maxLineLength;
+		if (tooLong)
+			answers += "error the line is too long\n";
+		if (not sendAll(client.socket, answers) or tooLong)
+			break;
+	}
+	shutdown(client.socket, SHUT_RDWR);
+	client.finished = true;
+}
+
+/** Parses the request and puts it in the queue.
+* @param begin, end the line of the request, without the end of the line
+* @return the future answer, with the end of the line
+*/
+std::future<std::string> myServer::submit(const char* begin, const char* end)
+{
+	auto item = std::make_shared<request>();
+	std::future<std::string> answer = item->answer.get_future();
+	begin = skipWhite(begin, end);
+	const char* nameEnd = begin;
+	while (nameEnd != end and not isWhite(*nameEnd))
+		++nameEnd;
+	item->net = networks.find(std::string(begin, nameEnd));
+	if (not item->net)
+	{
+		item->answer.set_value("error no such network\n");
+		return answer;
+	}
+	begin = skipWhite(nameEnd, end);
+	while (begin != end)
+	{
+		double value;
+		auto result = std::from_chars(*begin == '+' ? begin + 1 : begin, end, value);
+		if (result.ec != std::errc())
+		{
+			item->answer.set_value("error incorrect input\n");
+			return answer;
+		}
+		item->inputs.push_back(value);
+		begin = skipWhite(result.ptr, end);
+	}
+	item->arrival = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(item));
+	}
+	queueChanged.notify_all();
+	return answer;
+}
+
+/** The loop of a worker. It takes the first request of the queue with up to options.maxBatch - 1 following
+* requests of the same network, once there are enough of them or the first one has waited long enough.
+*/
+void myServer::work()
+{
+	myWorkspace workspace;
+	std::vector<std::shared_ptr<request>> batch;
+	std::vector<double> inputs, outputs;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueChanged.wait(lock, [&] { return stopping or not queue.empty(); });
+			if (queue.empty())
+				return;
+			queueChanged.wait_until(lock, queue.front()->arrival + options.maxWait,
+				[&]
+				{
+					if (stopping or queue.empty())
+						return true;
+					const auto& net = queue.front()->net;
+					return size_t(std::count_if(queue.begin(), queue.end(),
+						[&](const std::shared_ptr<request>& item) { return item->net == net; })) >= options.maxBatch;
+				});
+			if (queue.empty())
+				continue;
+			std::shared_ptr<net_entity> net = queue.front()->net;
+			for (auto item = queue.begin(); item != queue.end() and batch.size() < options.maxBatch;)
+				if ((*item)->net == net)
+				{
+					batch.push_back(std::move(*item));
+					item = queue.erase(item);
+				}
+				else
+					++item;
+		}
+		std::shared_ptr<net_entity> net = batch.front()->net;
+		std::shared_lock<std::shared_mutex> lock(net->access);
+		const myNetwork& network = net->network;
+		size_t inputSize = network.inputSize(), outputSize = network.outputSize();
+		auto last = std::stable_partition(batch.begin(), batch.end(),
+			[&](const std::shared_ptr<request>& item) { return inputSize != 0 and item->inputs.size() == inputSize; });
+		for (auto item = last; item != batch.end(); ++item)
+			(*item)->answer.set_value("error the number of the inputs should be " + std::to_string(inputSize) + "\n");
+		batch.erase(last, batch.end());
+		inputs.clear();
+		for (const auto& item : batch)
+			inputs.insert(inputs.end(), item->inputs.begin(), item->inputs.end());
+		outputs.resize(batch.size() * outputSize);
+		try
+		{
+			if (not batch.empty())
+				network.inferBatch(inputs.data(), batch.size(), outputs.data(), workspace);
+		}
+		catch (...)
+		{
+			for (const auto& item : batch)
+				item->answer.set_value("error the outputs could not be computed\n");
+			batch.clear();
+		}
+		lock.unlock();
+		char number[32];
+		for (size_t r = 0; r < batch.size(); ++r)
+		{
+			std::string text;
+			for (size_t i = 0; i < outputSize; ++i)
+			{
+				auto result = std::to_chars(number, number + sizeof(number), outputs[r * outputSize + i]);
+				text.append(number, result.ptr);
+				text += i + 1 < outputSize ? ' ' : '\n';
+			}
+			batch[r]->answer.set_value(std::move(text));
+		}
+		batch.clear();
+	}
+}
+#endif
@@ -0,0 +1,86 @@
+/**@file*/
+
+#pragma once
+#include "interface.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** The settings of the server.
+*/
+struct server_options
+{
+	size_t maxBatch = 32;
+	std::chrono::microseconds maxWait = std::chrono::microseconds(500);
+	size_t workersNumber = 1;
+};
+
+/** A server computing the outputs of the networks of the registry for requests sent over a Unix domain
+* socket or a TCP connection on the local host. A request is a line with the name of a network and its
+* input values separated with white characters; the answer is a line with the output values, or with
+* "error" and the reason. A client may send many requests without waiting for the answers, which come
+* in the same order.
+*
+* Every connection is read by its own thread, which puts the requests in one queue. The workers take
+* the requests from the queue in micro-batches of one network: a worker waits until options.maxBatch
+* requests have come or options.maxWait has passed since the first of them arrived, and then propagates
+* the whole batch at once in its own workspace, holding the network only shared. The networks are found
+* anew for every request, so a network reloaded in the meantime serves the following requests.
+*/
+class myServer
+{
+	struct request
+	{
+		std::shared_ptr<net_entity> net;
+		std::vector<double> inputs;
+		std::chrono::steady_clock::time_point arrival;
+		std::promise<std::string> answer;
+	};
+
+	struct connection
+	{
+		int socket;
+		std::thread reader;
+		std::atomic<bool> finished;
+		connection(int _socket) : socket(_socket), finished(false) {}
+	};
+
+	const myRegistry<net_entity>& networks;
+	server_options options;
+	int listener;
+	std::string socketPath;
+	std::thread acceptor;
+	std::vector<std::thread> workers;
+
+	std::mutex queueMutex;
+	std::condition_variable queueChanged;
+	std::deque<std::shared_ptr<request>> queue;
+	bool stopping;
+
+	std::mutex connectionsMutex;
+	std::list<std::unique_ptr<connection>> connections;
+	std::atomic<bool> running;
+
+	void accept();
+	void serve(connection& client);
+	std::future<std::string> submit(const char* begin, const char* end);
+	void work();
+
+public:
+	myServer(const myRegistry<net_entity>& _networks) : networks(_networks), listener(-1), stopping(false), running(false) {}
+	~myServer() { stop(); }
+	myServer(const myServer&) = delete;
+	myServer& operator=(const myServer&) = delete;
+
+	void start(std::string address, const server_options& _options = server_options());
+	void stop();
+	bool active() const { return running; }
+};
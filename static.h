@@ -0,0 +1,194 @@
+/**@file*/
+
+#pragma once
+#include "kernels.h"
+#include "network.h"
+#include <array>
+#include <string>
+#include <vector>
+
+/** A layer of a network with a layout fixed at compile time. The weights are transposed, input by
+* input, and multiplied by the affine kernel, which picks the widest instruction set at run time;
+* plain loops of constant length are vectorized only as far as the flags of the compiler allow.
+*/
+template<typename scalar, size_t inputsNumber, size_t neuronsNumber>
+struct static_layer
+{
+	std::array<scalar, inputsNumber * neuronsNumber> weights;
+	std::array<scalar, neuronsNumber> biases;
+	activation function;
+
+	void compute(const scalar* inputs, scalar* outputs) const
+	{
+		affine(neuronsNumber, inputsNumber, inputs, weights.data(), biases.data(), outputs);
+		activate(function, outputs, neuronsNumber);
+	}
+};
+
+/** The layers following the input one, each holding its successors. The outputs of every layer
+* are kept on the stack of the call computing it.
+*/
+template<typename scalar, size_t... sizes>
+struct static_layers;
+
+template<typename scalar, size_t outputsNumber>
+struct static_layers<scalar, outputsNumber>
+{
+};
+
+template<typename scalar, size_t inputsNumber, size_t neuronsNumber, size_t... following>
+struct static_layers<scalar, inputsNumber, neuronsNumber, following...>
+{
+	static_layer<scalar, inputsNumber, neuronsNumber> first;
+	static_layers<scalar, neuronsNumber, following...> rest;
+
+	void infer(const scalar* inputs, scalar* outputs) const
+	{
+		if constexpr (sizeof...(following) == 0)
+			first.compute(inputs, outputs);
+		else
+		{
+			std::array<scalar, neuronsNumber> values;
+			first.compute(inputs, values.data());
+			rest.infer(values.data(), outputs);
+		}
+	}
+
+	/** Copies the weights of the layers of the network from the given one on.
+	*/
+	void copyFrom(const std::vector<myBasicLayer<scalar>>& layers, size_t l)
+	{
+		const scalar* weights = layers[l].weightValues();
+		for (size_t n = 0; n < neuronsNumber; ++n)
+		{
+			for (size_t i = 0; i < inputsNumber; ++i)
+				first.weights[i * neuronsNumber + n] = weights[n * (inputsNumber + 1) + i];
+			first.biases[n] = weights[n * (inputsNumber + 1) + inputsNumber];
+		}
+		first.function = layers[l].getActivation();
+		if constexpr (sizeof...(following) != 0)
+			rest.copyFrom(layers, l + 1);
+	}
+
+	/** Sets the weights of the layers of the network from the given one on, which must have the same layout.
+	*/
+	void copyTo(myBasicNetwork<scalar>& network, size_t l) const
+	{
+		std::vector<scalar> weights(inputsNumber + 1);
+		for (size_t n = 0; n < neuronsNumber; ++n)
+		{
+			for (size_t i = 0; i < inputsNumber; ++i)
+				weights[i] = first.weights[i * neuronsNumber + n];
+			weights[inputsNumber] = first.biases[n];
+			network.setInputWeights(l, n, weights);
+		}
+		if constexpr (sizeof...(following) != 0)
+			rest.copyTo(network, l + 1);
+	}
+
+	void activations(std::vector<activation>& functions) const
+	{
+		functions.push_back(first.function);
+		if constexpr (sizeof...(following) != 0)
+			rest.activations(functions);
+	}
+};
+
+/** A network whose layout is fixed at compile time, e.g. myStaticNetwork<16, 32, 8, 1>, for inference
+* with small models. The weights are held in arrays inside the object and the outputs of the layers
+* on the stack, so no memory is allocated and nothing is reached through pointers to other blocks.
+* The sequence of the layers is fixed at compile time, but every layer still calls the affine and
+* activation kernels chosen at run time, so the arithmetic itself is not inlined or unrolled for the
+* layout. It is converted from and to myBasicNetwork,
+* through which it is read and saved in the usual formats.
+*/
+template<typename scalar, size_t... sizes>
+class myBasicStaticNetwork
+{
+	static_assert(sizeof...(sizes) >= 2, "A network needs at least two layers.");
+	static constexpr std::array<size_t, sizeof...(sizes)> layout = { sizes... };
+
+	static_layers<scalar, sizes...> networkBody;
+
+public:
+	static constexpr size_t inputSize() { return layout.front(); }
+	static constexpr size_t outputSize() { return layout.back(); }
+
+	myBasicStaticNetwork() : myBasicStaticNetwork(myBasicNetwork<scalar>(std::vector<size_t>(layout.begin(), layout.end()))) {}
+	explicit myBasicStaticNetwork(const myBasicNetwork<scalar>& network) { assign(network); }
+	explicit myBasicStaticNetwork(std::string path) { read(path); }
+
+	void assign(const myBasicNetwork<scalar>& network);
+	myBasicNetwork<scalar> toNetwork() const;
+	void read(std::string path);
+	void save(std::string path) const;
+
+	/** Computes the outputs for the inputs. No memory is allocated.
+	* @param inputs pointer to inputSize() input values
+	* @param outputs pointer to the buffer of outputSize() values to which the outputs shall be written
+	*/
+	void infer(const scalar* inputs, scalar* outputs) const { networkBody.infer(inputs, outputs); }
+	std::array<scalar, outputSize()> infer(const std::array<scalar, inputSize()>& inputs) const
+	{
+		std::array<scalar, outputSize()> outputs;
+		networkBody.infer(inputs.data(), outputs.data());
+		return outputs;
+	}
+};
+
+template<size_t... sizes>
+using myStaticNetwork = myBasicStaticNetwork<double, sizes...>;
+
+/** Copies the weights and the activation functions of the network, whose layout must be the same.
+* @param network the network to be copied
+*/
+template<typename scalar, size_t... sizes>
+void myBasicStaticNetwork<scalar, sizes...>::assign(const myBasicNetwork<scalar>& network)
+{
+	const auto& layers = network.layers();
+	if (layers.size() != layout.size())
+		throw incompatible_vectors();
+	for (size_t l = 0; l < layers.size(); ++l)
+		if (layers[l].size() - 1 != layout[l])
+			throw incompatible_vectors();
+	networkBody.copyFrom(layers, 1);
+}
+
+/** Returns a regular network with the same layout, weights and activation functions.
+*/
+template<typename scalar, size_t... sizes>
+myBasicNetwork<scalar> myBasicStaticNetwork<scalar, sizes...>::toNetwork() const
+{
+	std::vector<activation> functions = { activation::tanh };
+	networkBody.activations(functions);
+	myBasicNetwork<scalar> network(std::vector<size_t>(layout.begin(), layout.end()), functions);
+	networkBody.copyTo(network, 1);
+	return network;
+}
+
+/** Reads the network from a .net or .netb file, whose layout must be the same.
+* @param path the path from which the network shall be read
+*/
+template<typename scalar, size_t... sizes>
+void myBasicStaticNetwork<scalar, sizes...>::read(std::string path)
+{
+	myBasicNetwork<scalar> network;
+	network.read(path);
+	assign(network);
+}
+
+/** Saves the network as .net or .netb, according to the extension of the path.
+* @param path the path on which the network shall be saved
+*/
+template<typename scalar, size_t... sizes>
+void myBasicStaticNetwork<scalar, sizes...>::save(std::string path) const
+{
+	myBasicNetwork<scalar> network = toNetwork();
+	std::string type = extension(path);
+	if (type == ".netb")
+		network.saveBinary(path);
+	else if (type == ".net")
+		network.saveNetwork(path);
+	else
+		throw bad_extension(filetype::net);
+}
@@ -0,0 +1,150 @@
+#include "statistics.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	const size_t countersNumber = 4;
+
+	/** The calls, records, bytes and nanoseconds of every phase counted by one thread. Only the thread
+	* itself changes them, with a plain load and store, so that counting takes no locked instruction
+	* and no cache line is shared between the threads; they are atomic only to be read by others.
+	*/
+	struct thread_counters
+	{
+		std::atomic<uint64_t> values[phasesNumber][countersNumber] = {};
+
+		thread_counters();
+		~thread_counters();
+	};
+
+	/** The counters of all the threads. The counts of the threads which have finished are kept in
+	* retired; a reset does not touch the counters of the threads, but keeps their sums as the baseline.
+	*/
+	struct all_counters
+	{
+		std::mutex mutex;
+		std::vector<thread_counters*> threads;
+		uint64_t retired[phasesNumber][countersNumber] = {}, baseline[phasesNumber][countersNumber] = {};
+		std::chrono::steady_clock::time_point resetTime = std::chrono::steady_clock::now();
+
+		uint64_t sum(size_t p, size_t c) const
+		{
+			uint64_t total = retired[p][c];
+			for (const thread_counters* counters : threads)
+				total += counters->values[p][c].load(std::memory_order_relaxed);
+			return total;
+		}
+	};
+
+	all_counters& allCounters()
+	{
+		static all_counters instance;
+		return instance;
+	}
+
+	const bool startTimeSet = (allCounters(), true);
+
+	thread_counters::thread_counters()
+	{
+		all_counters& all = allCounters();
+		std::lock_guard<std::mutex> lock(all.mutex);
+		all.threads.push_back(this);
+	}
+
+	thread_counters::~thread_counters()
+	{
+		all_counters& all = allCounters();
+		std::lock_guard<std::mutex> lock(all.mutex);
+		for (size_t p = 0; p < phasesNumber; ++p)
+			for (size_t c = 0; c < countersNumber; ++c)
+				all.retired[p][c] += values[p][c].load(std::memory_order_relaxed);
+		all.threads.erase(std::find(all.threads.begin(), all.threads.end(), this));
+	}
+
+	void add(std::atomic<uint64_t>& counter, uint64_t n)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+}
+
+const char* phaseName(phase stage)
+{
+	switch (stage)
+	{
+	case phase::propagation:
+		return "propagation";
+	case phase::gradients:
+		return "gradients";
+	case phase::update:
+		return "update";
+	case phase::recordTraining:
+		return "per record";
+	default:
+		return "parsing";
+	}
+}
+
+/** Tells whether the statistics are collected, which is decided at compile time by NO_STATISTICS.
+*/
+bool statisticsEnabled()
+{
+#ifndef NO_STATISTICS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/** Returns the statistics of the phase gathered by all the threads since the start of the program or the last reset.
+* @param stage the phase
+*/
+phase_statistics readStatistics(phase stage)
+{
+	all_counters& all = allCounters();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	size_t p = size_t(stage);
+	uint64_t values[countersNumber];
+	for (size_t c = 0; c < countersNumber; ++c)
+		values[c] = all.sum(p, c) - all.baseline[p][c];
+	return { values[0], values[1], values[2], values[3] * 1e-9 };
+}
+
+/** Sets the statistics of all the phases to zero and restarts the measurement of the elapsed time.
+*/
+void resetStatistics()
+{
+	all_counters& all = allCounters();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	for (size_t p = 0; p < phasesNumber; ++p)
+		for (size_t c = 0; c < countersNumber; ++c)
+			all.baseline[p][c] = all.sum(p, c);
+	all.resetTime = std::chrono::steady_clock::now();
+}
+
+/** Returns the wall-clock time elapsed since the start of the program or the last reset.
+*/
+double elapsedSeconds()
+{
+	all_counters& all = allCounters();
+	std::lock_guard<std::mutex> lock(all.mutex);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - all.resetTime).count();
+}
+
+/** Adds a measurement to the statistics of the phase kept by the calling thread.
+* @param stage the phase
+* @param nanoseconds the time of the measurement
+* @param records the number of records processed
+* @param bytes the number of bytes read
+*/
+void recordPhase(phase stage, uint64_t nanoseconds, uint64_t records, uint64_t bytes)
+{
+	thread_local thread_counters own;
+	std::atomic<uint64_t>* values = own.values[size_t(stage)];
+	add(values[0], 1);
+	add(values[1], records);
+	add(values[2], bytes);
+	add(values[3], nanoseconds);
+}
@@ -0,0 +1,57 @@
+/**@file*/
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/** The phases of the work whose time is measured. The batches and chunks are timed as a whole, and so
+* is the training record by record, in which the other phases of every record are interleaved; single
+* records propagated by myNetwork::infer are not timed. If NO_STATISTICS is defined, nothing is measured.
+*/
+enum class phase { propagation, gradients, update, recordTraining, parsing };
+const size_t phasesNumber = 5;
+
+struct phase_statistics
+{
+	uint64_t calls, records, bytes;
+	double seconds;
+};
+
+const char* phaseName(phase stage);
+bool statisticsEnabled();
+phase_statistics readStatistics(phase stage);
+void resetStatistics();
+double elapsedSeconds();
+void recordPhase(phase stage, uint64_t nanoseconds, uint64_t records, uint64_t bytes);
+
+/** Measures the time from its construction to its destruction and adds it, with the numbers of
+* records and bytes processed, to the statistics of the phase kept by the calling thread. The phases
+* timed on many threads at once have their times summed over the threads.
+*/
+class myPhaseTimer
+{
+#ifndef NO_STATISTICS
+	phase stage;
+	uint64_t records, bytes;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	myPhaseTimer(phase _stage, uint64_t _records = 1)
+		: stage(_stage), records(_records), bytes(0), start(std::chrono::steady_clock::now()) {}
+	~myPhaseTimer()
+	{
+		auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		recordPhase(stage, uint64_t(time.count()), records, bytes);
+	}
+	void addRecords(uint64_t n) { records += n; }
+	void addBytes(uint64_t n) { bytes += n; }
+#else
+public:
+	myPhaseTimer(phase, uint64_t = 1) {}
+	void addRecords(uint64_t) {}
+	void addBytes(uint64_t) {}
+#endif
+	myPhaseTimer(const myPhaseTimer&) = delete;
+	myPhaseTimer& operator=(const myPhaseTimer&) = delete;
+};
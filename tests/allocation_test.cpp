@@ -0,0 +1,71 @@
+/**@file
+* Checks that the inference of myNetwork allocates no memory once its workspace has grown, built as a separate
+* program from all the sources except main.cpp, interface.cpp and server.cpp, e.g.
+* g++ -std=c++17 -O2 -pthread -I.. allocation_test.cpp $(find .. -maxdepth 1 -name "*.cpp" | grep -v "main\|interface\|server") -o allocation_test
+* The program returns 0 when the check passes.
+*/
+
+#include "../network.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
+
+namespace
+{
+	size_t allocations = 0;
+	bool counting = false;
+}
+
+void* operator new(size_t size)
+{
+	if (counting)
+		++allocations;
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+int main()
+{
+	myNetwork small({ 4, 16, 2 }), large({ 4, 32, 64, 32, 2 });
+	double inputs[4 * 8] = { 0.1, 0.2, 0.3, 0.4 }, outputs[2 * 8];
+	myWorkspace workspace;
+	small.infer(inputs, 4, outputs);
+	large.infer(inputs, 4, outputs);
+	large.inferBatch(inputs, 8, outputs, workspace);
+
+	counting = true;
+	for (size_t i = 0; i < 100; ++i)
+	{
+		small.infer(inputs, 4, outputs);
+		large.infer(inputs, 4, outputs);
+		small.infer(inputs, 4, outputs, workspace);
+		large.infer(inputs, 4, outputs, workspace);
+		small.inferBatch(inputs, 8, outputs, workspace);
+		large.inferBatch(inputs, 8, outputs, workspace);
+	}
+	counting = false;
+
+	std::cout << "Allocations in 600 inferences: " << allocations << std::endl;
+	if (allocations != 0)
+	{
+		std::cerr << "FAILED: the inference should allocate nothing." << std::endl;
+		return 1;
+	}
+	std::cout << "PASSED" << std::endl;
+	return 0;
+}
@@ -0,0 +1,113 @@
+/**@file
+* Checks that the asynchronous (Hogwild) training converges on a synthetic set as the sequential one does, and compares
+* their throughputs, built as a separate program from all the sources except main.cpp, interface.cpp and server.cpp, e.g.
+* g++ -std=c++17 -O2 -pthread -I.. hogwild_test.cpp $(find .. -maxdepth 1 -name "*.cpp" | grep -v "main\|interface\|server") -o hogwild_test
+* Usage: hogwild_test [threads_number]
+* The program returns 0 when the check passes.
+*/
+
+#include "../network.h"
+#include "../threads.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
+
+namespace
+{
+	const size_t inputsNumber = 8, recordsNumber = 4000, epochsNumber = 20;
+
+	double random() { return rand() / double(RAND_MAX) * 2.0 - 1.0; }
+
+	/** Makes a set whose target is a smooth function of the inputs, which a small network can learn.
+	*/
+	myDataSet syntheticSet()
+	{
+		std::stringstream records;
+		records.precision(17);
+		for (size_t r = 0; r < recordsNumber; ++r)
+		{
+			double x[inputsNumber], sum = 0.0;
+			for (size_t i = 0; i < inputsNumber; ++i)
+			{
+				x[i] = random();
+				records << x[i] << ' ';
+				sum += (i % 2 == 0 ? 0.6 : -0.4) * x[i];
+			}
+			records << 0.8 * tanh(sum) + 0.1 * x[0] * x[1] << '\n';
+		}
+		myDataSet set;
+		set.readRecords(records, inputsNumber, 1, recordsNumber);
+		return set;
+	}
+
+	struct training_result
+	{
+		double initialError, finalError, recordsPerSecond;
+		bool decreasing;
+	};
+
+	/** Trains a fresh network for epochsNumber epochs, sequentially when threadsNumber is 0. The progress
+	* printed by the training is discarded.
+	*/
+	training_result train(const myDataSet& set, size_t threadsNumber)
+	{
+		std::ostringstream progress;
+		std::streambuf* output = std::cout.rdbuf(progress.rdbuf());
+		srand(2);
+		myNetwork network({ inputsNumber, 16, 1 });
+		training_result result;
+		result.initialError = network.testSet(set);
+		result.decreasing = true;
+		double seconds = 0.0, previous = result.initialError;
+		for (size_t epoch = 0; epoch < epochsNumber; ++epoch)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (threadsNumber == 0)
+				network.trainSet(set);
+			else
+				network.trainSetAsync(set, threadsNumber);
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double error = network.testSet(set);
+			// Every few epochs the error must have dropped, which tolerates the noise of the races between single epochs.
+			if (epoch % 5 == 4)
+			{
+				result.decreasing = result.decreasing and error < previous;
+				previous = error;
+			}
+			result.finalError = error;
+			progress.str("");
+		}
+		std::cout.rdbuf(output);
+		result.recordsPerSecond = double(set.size() * epochsNumber) / seconds;
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t threadsNumber = argc > 1 ? std::stoul(argv[1]) : std::max<size_t>(2, defaultThreadsNumber());
+	myDataSet set = syntheticSet();
+	training_result sequential = train(set, 0), asynchronous = train(set, threadsNumber);
+	std::cout << "sequential: error " << sequential.initialError << " -> " << sequential.finalError << ", "
+		<< sequential.recordsPerSecond << " records/s" << std::endl;
+	std::cout << "asynchronous, " << threadsNumber << " threads: error " << asynchronous.initialError << " -> "
+		<< asynchronous.finalError << ", " << asynchronous.recordsPerSecond << " records/s, "
+		<< asynchronous.recordsPerSecond / sequential.recordsPerSecond << " times the sequential throughput" << std::endl;
+	bool passed = sequential.decreasing and asynchronous.decreasing
+		and asynchronous.finalError < 0.5 * asynchronous.initialError
+		and asynchronous.finalError < 1.5 * sequential.finalError;
+	if (not passed)
+	{
+		std::cerr << "FAILED: the asynchronous training should keep decreasing the error, halve it, "
+			"and end within 1.5 times the error of the sequential training." << std::endl;
+		return 1;
+	}
+	std::cout << "PASSED" << std::endl;
+	return 0;
+}
@@ -0,0 +1,141 @@
+/**@file
+* Checks every instruction set the processor supports against scalar loops for the kernels of kernels.h, built as a
+* separate program from all the sources except main.cpp, interface.cpp and server.cpp, e.g.
+* g++ -std=c++17 -O2 -pthread -I.. kernels_test.cpp $(find .. -maxdepth 1 -name "*.cpp" | grep -v "main\|interface\|server") -o kernels_test
+* The program returns 0 when all the checks pass.
+*/
+
+#include "../kernels.h"
+#include "../network.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
+
+namespace
+{
+	/** The lengths checked, with every remainder of the vector widths.
+	*/
+	const std::vector<size_t> lengths = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257, 1023 };
+
+	template<typename scalar>
+	std::vector<scalar> randomValues(size_t n)
+	{
+		std::vector<scalar> values(n);
+		for (auto& value : values)
+			value = scalar(rand() / double(RAND_MAX) * 2.0 - 1.0);
+		return values;
+	}
+
+	/** The largest error of the kernels relative to the sum of the magnitudes of the terms of every result,
+	* which bounds the rounding differences of reordered or fused operations.
+	*/
+	template<typename scalar>
+	double kernelsError()
+	{
+		double error = 0.0;
+		auto relative = [&](double value, double exact, double magnitude)
+		{
+			error = std::max(error, std::fabs(value - exact) / std::max(magnitude, 1e-300));
+		};
+		for (size_t n : lengths)
+		{
+			std::vector<scalar> a = randomValues<scalar>(n), b = randomValues<scalar>(n);
+			double exact = 0.0, magnitude = 0.0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				exact += double(a[i]) * double(b[i]);
+				magnitude += std::fabs(double(a[i]) * double(b[i]));
+			}
+			relative(double(dot(a.data(), b.data(), n)), exact, magnitude);
+
+			std::vector<scalar> y = b;
+			scalar alpha = scalar(0.37);
+			axpy(alpha, a.data(), y.data(), n);
+			for (size_t i = 0; i < n; ++i)
+				relative(double(y[i]), double(b[i]) + double(alpha) * double(a[i]),
+					std::fabs(double(b[i])) + std::fabs(double(alpha) * double(a[i])));
+
+			std::vector<scalar> differences = randomValues<scalar>(n), weights = randomValues<scalar>(n);
+			std::vector<scalar> oldDifferences = differences, oldWeights = weights;
+			scalar step = scalar(-0.01), momentum = scalar(0.5);
+			momentumUpdate(step, a.data(), momentum, differences.data(), weights.data(), n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				double difference = double(step) * double(a[i]) + double(momentum) * double(oldDifferences[i]);
+				double differenceMagnitude = std::fabs(double(step) * double(a[i])) + std::fabs(double(momentum) * double(oldDifferences[i]));
+				relative(double(differences[i]), difference, differenceMagnitude);
+				relative(double(weights[i]), double(oldWeights[i]) + difference, std::fabs(double(oldWeights[i])) + differenceMagnitude);
+			}
+
+			size_t N = n % 37 + 1;
+			std::vector<scalar> weightsMatrix = randomValues<scalar>(n * N), biases = randomValues<scalar>(N), outputs(N);
+			affine(N, n, a.data(), weightsMatrix.data(), biases.data(), outputs.data());
+			for (size_t j = 0; j < N; ++j)
+			{
+				double sum = double(biases[j]), sumMagnitude = std::fabs(double(biases[j]));
+				for (size_t k = 0; k < n; ++k)
+				{
+					sum += double(a[k]) * double(weightsMatrix[k * N + j]);
+					sumMagnitude += std::fabs(double(a[k]) * double(weightsMatrix[k * N + j]));
+				}
+				relative(double(outputs[j]), sum, sumMagnitude);
+			}
+		}
+		return error;
+	}
+
+	/** Tells whether the dot product of 8-bit integers is exact.
+	*/
+	bool integerDotExact()
+	{
+		for (size_t n : lengths)
+		{
+			std::vector<int8_t> a(n), b(n);
+			int32_t exact = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				a[i] = int8_t(rand() % 255 - 127);
+				b[i] = int8_t(rand() % 255 - 127);
+				exact += int32_t(a[i]) * int32_t(b[i]);
+			}
+			if (dot(a.data(), b.data(), n) != exact)
+				return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	const double doubleBound = 1e-15, floatBound = 1e-6;
+	bool passed = true;
+	for (instruction_set set : { instruction_set::portable, instruction_set::avx2, instruction_set::avx512 })
+	{
+		if (not selectInstructionSet(set))
+		{
+			std::cout << instructionSetName(set) << ": not supported, skipped" << std::endl;
+			continue;
+		}
+		srand(1);
+		double doubleError = kernelsError<double>(), floatError = kernelsError<float>();
+		bool exact = integerDotExact();
+		std::cout << instructionSetName(set) << ": relative error double " << doubleError << ", float " << floatError
+			<< ", int8 dot " << (exact ? "exact" : "INEXACT") << std::endl;
+		if (doubleError > doubleBound or floatError > floatBound or not exact)
+			passed = false;
+	}
+	selectInstructionSet(detectInstructionSet());
+	if (not passed)
+	{
+		std::cerr << "FAILED: the relative errors should stay below " << doubleBound << " for double and "
+			<< floatBound << " for float." << std::endl;
+		return 1;
+	}
+	std::cout << "PASSED" << std::endl;
+	return 0;
+}
@@ -0,0 +1,100 @@
+/**@file
+* Measures the largest absolute error of the fast tanh of every instruction set the processor supports and checks
+* the derivative of tanh, built as a separate program from all the sources except main.cpp, interface.cpp and
+* server.cpp, e.g.
+* g++ -std=c++17 -O2 -pthread -I.. tanh_test.cpp $(find .. -maxdepth 1 -name "*.cpp" | grep -v "main\|interface\|server") -o tanh_test
+* The program returns 0 when all the checks pass.
+*/
+
+#include "../activation.h"
+#include "../kernels.h"
+#include "../network.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+double myLearning::learningRate = 0.01;
+double myLearning::momentum = 0.5;
+
+namespace
+{
+	/** The bound of the absolute error documented for the fast tanh.
+	*/
+	const double errorBound = 5e-7;
+
+	/** The points checked: a fine grid over [-10, 10], beyond which tanh is +-1 in double, and the edge cases.
+	*/
+	std::vector<double> points()
+	{
+		const size_t steps = 2000000;
+		std::vector<double> values;
+		for (size_t i = 0; i <= steps; ++i)
+			values.push_back(-10.0 + 20.0 * double(i) / double(steps));
+		for (double value : { 0.0, -0.0, 1e-8, -1e-8, 7.90531110763549805, -7.90531110763549805, 20.0, -20.0, 1e300, -1e300 })
+			values.push_back(value);
+		return values;
+	}
+
+	/** The largest absolute difference between applyTanh in the selected mode and std::tanh in double.
+	*/
+	template<typename scalar>
+	double tanhError(const std::vector<double>& x)
+	{
+		std::vector<scalar> values(x.begin(), x.end());
+		applyTanh(values.data(), values.size());
+		double error = 0.0;
+		for (size_t i = 0; i < x.size(); ++i)
+			error = std::max(error, std::fabs(double(values[i]) - std::tanh(double(scalar(x[i])))));
+		return error;
+	}
+}
+
+int main()
+{
+	std::vector<double> x = points();
+	bool passed = true;
+	std::cout.precision(3);
+	selectTransferMode(transfer_mode::fast);
+	for (instruction_set set : { instruction_set::portable, instruction_set::avx2, instruction_set::avx512 })
+	{
+		if (not selectInstructionSet(set))
+		{
+			std::cout << instructionSetName(set) << ": not supported, skipped" << std::endl;
+			continue;
+		}
+		double doubleError = tanhError<double>(x), floatError = tanhError<float>(x);
+		std::cout << instructionSetName(set) << ": largest absolute error of the fast tanh, double " << doubleError
+			<< ", float " << floatError << std::endl;
+		if (doubleError >= errorBound or floatError >= errorBound)
+			passed = false;
+	}
+	selectInstructionSet(detectInstructionSet());
+
+	selectTransferMode(transfer_mode::exact);
+	double exactError = tanhError<double>(x);
+	std::cout << "exact: largest absolute error " << exactError << std::endl;
+	if (exactError != 0.0)
+		passed = false;
+
+	// The derivative is taken from the output y of tanh as 1 - y^2, not from tanh(y).
+	double derivativeError = 0.0;
+	for (double y : { -0.999, -0.5, 0.0, 0.25, 0.9 })
+	{
+		double gradient = 1.0;
+		multiplyDerivative(activation::tanh, &y, &gradient, 1);
+		derivativeError = std::max(derivativeError, std::fabs(gradient - (1.0 - y * y)));
+	}
+	std::cout << "derivative: largest absolute error " << derivativeError << std::endl;
+	if (derivativeError > 1e-15)
+		passed = false;
+
+	if (not passed)
+	{
+		std::cerr << "FAILED: the fast tanh should stay within " << errorBound
+			<< ", the exact one should match std::tanh and the derivative should be 1 - y^2." << std::endl;
+		return 1;
+	}
+	std::cout << "PASSED" << std::endl;
+	return 0;
+}
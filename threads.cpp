@@ -0,0 +1,92 @@
+#include "threads.h"
+
+/** Constructor
+* @param threadsNumber the number of threads executing the jobs, including the calling thread
+*/
+myThreadPool::myThreadPool(size_t threadsNumber) : generation(0), pending(0), stopping(false)
+{
+	for (size_t t = 1; t < threadsNumber; ++t)
+		workers.emplace_back(&myThreadPool::work, this, t);
+}
+
+/** Destructor; stops and joins the threads.
+*/
+myThreadPool::~myThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (auto& worker : workers)
+		worker.join();
+}
+
+/** The loop of a worker thread.
+* @param index the index of the worker passed to the jobs
+*/
+void myThreadPool::work(size_t index)
+{
+	size_t seen = 0;
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeUp.wait(lock, [&] { return stopping or generation != seen; });
+		if (stopping)
+			return;
+		seen = generation;
+		lock.unlock();
+		try
+		{
+			task(index);
+		}
+		catch (...)
+		{
+			lock.lock();
+			failure = std::current_exception();
+			lock.unlock();
+		}
+		lock.lock();
+		if (--pending == 0)
+			finished.notify_one();
+	}
+}
+
+/** Calls the job once on every thread of the pool, the calling thread included, and waits for all the calls to return.
+* The first exception thrown by any of the calls is rethrown.
+* @param job the function called with the index of the thread, from 0 to size() - 1
+*/
+void myThreadPool::run(const std::function<void(size_t)>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = job;
+		failure = nullptr;
+		pending = workers.size();
+		++generation;
+	}
+	wakeUp.notify_all();
+	std::exception_ptr ownFailure;
+	try
+	{
+		job(0);
+	}
+	catch (...)
+	{
+		ownFailure = std::current_exception();
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&] { return pending == 0; });
+	if (ownFailure)
+		std::rethrow_exception(ownFailure);
+	if (failure)
+		std::rethrow_exception(failure);
+}
+
+/** Returns the number of hardware threads, or 1 if it is unknown.
+*/
+size_t defaultThreadsNumber()
+{
+	size_t number = std::thread::hardware_concurrency();
+	return number == 0 ? 1 : number;
+}
@@ -0,0 +1,33 @@
+/**@file*/
+
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class myThreadPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeUp, finished;
+	std::function<void(size_t)> task;
+	std::exception_ptr failure;
+	size_t generation, pending;
+	bool stopping;
+
+	void work(size_t index);
+
+public:
+	myThreadPool(size_t threadsNumber);
+	~myThreadPool();
+	myThreadPool(const myThreadPool&) = delete;
+	myThreadPool& operator=(const myThreadPool&) = delete;
+
+	size_t size() const { return workers.size() + 1; }
+	void run(const std::function<void(size_t)>& job);
+};
+
+size_t defaultThreadsNumber();
@@ -1,6 +1,79 @@
 #include "training.h"
+#include "mapping.h"
+#include "statistics.h"
+#include "threads.h"
+#include <charconv>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <iostream>
+#include <utility>
+
+namespace
+{
+	/** The part of the file parsed by one thread.
+	*/
+	const size_t minimalRangeSize = 1 << 20;
+
+	bool isWhite(char c)
+	{
+		return c == ' ' or c == '\n' or c == '\t' or c == '\r' or c == '\v' or c == '\f';
+	}
+
+	const char* skipWhite(const char* begin, const char* end)
+	{
+		while (begin != end and isWhite(*begin))
+			++begin;
+		return begin;
+	}
+
+	/** Parses the numbers separated with white characters, stopping where operator>> would fail. A number
+	* may have one sign, '+' or '-'.
+	* @param begin, end the range of characters
+	* @param values the vector to which the numbers are appended
+	* @return true if the whole range has been parsed, false if something else than a number has been found
+	*/
+	template<typename scalar>
+	bool parseValues(const char* begin, const char* end, std::vector<scalar>& values)
+	{
+		while (true)
+		{
+			begin = skipWhite(begin, end);
+			if (begin == end)
+				return true;
+			const char* number = *begin == '+' ? begin + 1 : begin;
+			const char* digits = number == begin and *number == '-' ? number + 1 : number;
+			if (digits == end or not (isdigit(static_cast<unsigned char>(*digits)) or *digits == '.'))
+				return false;
+			scalar value;
+			auto result = std::from_chars(number, end, value);
+			if (result.ec != std::errc())
+				return false;
+			values.push_back(value);
+			begin = result.ptr;
+		}
+	}
+
+	/** Parses a positive integer of the header, which may have a sign.
+	* @param begin the position from which the integer is looked for; moved past the integer
+	* @param end the end of the file
+	* @return false if no integer was found
+	* @throw incorrect_contents if the integer is negative
+	*/
+	bool parseSize(const char*& begin, const char* end, unsigned long int& value)
+	{
+		begin = skipWhite(begin, end);
+		bool negative = begin != end and *begin == '-';
+		const char* digits = begin != end and (*begin == '+' or negative) ? begin + 1 : begin;
+		auto result = std::from_chars(digits, end, value);
+		if (result.ec != std::errc())
+			return false;
+		if (negative)
+			throw incorrect_contents();
+		begin = result.ptr;
+		return true;
+	}
+}
 
 /** Returns the substring from the last occurrence of the delimiter.
 * @param path the string from which the extension shall be extracted
@@ -17,61 +90,139 @@ std::string extension(std::string path, char delimiter)
 }
 
 /** Reads a set from the path.
+* The file is mapped into memory and split into ranges at white characters, which are parsed in parallel.
+* As with stream extraction, the records are read up to the first incomplete one or up to the first
+* token which is not a number.
 */
-void myDataSet::read(std::string path)
+template<typename scalar>
+void myBasicDataSet<scalar>::read(std::string path)
 {
-	std::ifstream source;
-	std::string type = extension(path);
-	unsigned long int inputsNumber, outputsNumber;
-	if (type == ".set")
-		source.open(path, std::ios::in);
-	else
+	if (extension(path) != ".set")
 		throw bad_extension(filetype::set);
-	if (not source.good())
+	myPhaseTimer timer(phase::parsing, 0);
+	myMappedFile file(path);
+	const char* position = file.data();
+	const char* end = file.data() + file.size();
+	unsigned long int inputsNumber, outputsNumber;
+	if (not parseSize(position, end, inputsNumber) or not parseSize(position, end, outputsNumber))
+		throw incomplete_contents();
+	if (inputsNumber == 0 or outputsNumber == 0)
+		throw incorrect_contents();
+
+	size_t threadsNumber = std::max<size_t>(1, std::min<size_t>(defaultThreadsNumber(), (end - position) / minimalRangeSize));
+	std::vector<const char*> bounds(threadsNumber + 1, end);
+	bounds[0] = position;
+	for (size_t t = 1; t < threadsNumber; ++t)
 	{
-		source.close();
-		throw no_file();
+		const char* bound = std::max(bounds[t - 1], position + (end - position) * t / threadsNumber);
+		while (bound != end and not isWhite(*bound))
+			++bound;
+		bounds[t] = bound;
 	}
-	if (not (source >> inputsNumber >> outputsNumber))
+	std::vector<std::vector<scalar>> values(threadsNumber);
+	std::vector<char> complete(threadsNumber);
+	myThreadPool pool(threadsNumber);
+	pool.run([&](size_t t) {
+		values[t].reserve((bounds[t + 1] - bounds[t]) / 4);
+		complete[t] = parseValues(bounds[t], bounds[t + 1], values[t]);
+	});
+
+	size_t recordSize = inputsNumber + outputsNumber, recordsRead = 0;
+	for (size_t t = 0; t < threadsNumber; ++t)
+	{
+		recordsRead += values[t].size();
+		if (not complete[t])
+			break;
+	}
+	recordsRead /= recordSize;
+	if (recordsRead == 0)
 		throw incomplete_contents();
-	if (inputsNumber == 0 or outputsNumber == 0)
+	setSizes(inputsNumber, outputsNumber);
+	size_t firstRecord = recordsNumber;
+	inputValues.resize((firstRecord + recordsRead) * inputsNumber);
+	targetValues.resize((firstRecord + recordsRead) * outputsNumber);
+	scalar* input = &inputValues[firstRecord * inputsNumber];
+	scalar* target = &targetValues[firstRecord * outputsNumber];
+	size_t range = 0, index = 0;
+	auto nextValue = [&]() {
+		while (index == values[range].size())
+		{
+			++range;
+			index = 0;
+		}
+		return values[range][index++];
+	};
+	for (size_t r = 0; r < recordsRead; ++r)
 	{
-		source.close();
-		throw incorrect_contents();
+		for (size_t i = 0; i < inputsNumber; ++i)
+			*input++ = nextValue();
+		for (size_t i = 0; i < outputsNumber; ++i)
+			*target++ = nextValue();
 	}
-	while (true)
+	recordsNumber += recordsRead;
+	timer.addRecords(recordsRead);
+	timer.addBytes(file.size());
+}
+
+/** Sets the sizes of the records, which must agree with the records already in the set.
+* @param _inputsNumber the number of input values of a record
+* @param _outputsNumber the number of target values of a record
+*/
+template<typename scalar>
+void myBasicDataSet<scalar>::setSizes(size_t _inputsNumber, size_t _outputsNumber)
+{
+	if (recordsNumber != 0 and (inputsNumber != _inputsNumber or outputsNumber != _outputsNumber))
+		throw incompatible_vectors();
+	inputsNumber = _inputsNumber;
+	outputsNumber = _outputsNumber;
+}
+
+/** Reads records from the source and appends them to the set. An incomplete record at the end of the source is skipped.
+* @param source the stream positioned at the beginning of a record
+* @param inputsNumber the number of input values of a record
+* @param outputsNumber the number of target values of a record
+* @param maxRecords the maximal number of records to be read
+* @return the number of records read; if it is lower than maxRecords, the source has ended
+*/
+template<typename scalar>
+size_t myBasicDataSet<scalar>::readRecords(std::istream& source, size_t inputsNumber, size_t outputsNumber, size_t maxRecords)
+{
+	setSizes(inputsNumber, outputsNumber);
+	for (size_t r = 0; r < maxRecords; ++r)
 	{
-		dataBase.push_back(myDataRecord(inputsNumber, outputsNumber));
+		inputValues.resize((recordsNumber + 1) * inputsNumber);
+		targetValues.resize((recordsNumber + 1) * outputsNumber);
+		scalar* input = &inputValues[recordsNumber * inputsNumber];
+		scalar* target = &targetValues[recordsNumber * outputsNumber];
 		for (size_t i = 0; i < inputsNumber; ++i)
-			if (not (source >> dataBase.back().inputValues[i]))
+			if (not (source >> input[i]))
 			{
-				dataBase.pop_back();
-				if (dataBase.empty())
-					throw incomplete_contents();
-				else
-					return;
+				inputValues.resize(recordsNumber * inputsNumber);
+				targetValues.resize(recordsNumber * outputsNumber);
+				return r;
 			}
 		for (size_t i = 0; i < outputsNumber; ++i)
-			if (not (source >> dataBase.back().targetValues[i]))
+			if (not (source >> target[i]))
 			{
-				dataBase.pop_back();
-				if (dataBase.empty())
-					throw incomplete_contents();
-				else
-					return;
+				inputValues.resize(recordsNumber * inputsNumber);
+				targetValues.resize(recordsNumber * outputsNumber);
+				return r;
 			}
+		++recordsNumber;
 	}
+	return maxRecords;
 }
 
 /** Prints the contents of the set.
 */
-void myDataSet::printData()
+template<typename scalar>
+void myBasicDataSet<scalar>::printData()
 {
-	if (dataBase.empty())
+	if (empty())
 		std::cout << "No data have been read." << std::endl;
 	else
 	{
-		for (const auto& record : dataBase)
+		for (const auto& record : *this)
 		{
 			std::cout << "inputs: ";
 			for (const auto& input : record.inputValues)
@@ -86,18 +237,194 @@ void myDataSet::printData()
 
 /** Returns the size of the input vectors.
 */
-size_t myDataSet::inputSize() const
+template<typename scalar>
+size_t myBasicDataSet<scalar>::inputSize() const
 {
-	if (dataBase.empty())
+	if (empty())
 		throw empty_set();
-	return dataBase[0].inputValues.size();
+	return inputsNumber;
 }
 
 /** Returns the size of the output vectors.
 */
-size_t myDataSet::outputSize() const
+template<typename scalar>
+size_t myBasicDataSet<scalar>::outputSize() const
 {
-	if (dataBase.empty())
+	if (empty())
 		throw empty_set();
-	return dataBase[0].targetValues.size();
+	return outputsNumber;
+}
+
+/** Constructor; opens the set file and reads its header.
+* @param _path the path of the set file
+* @param _chunkSize the maximal number of records in a chunk
+* @param bufferSize the size of the buffer through which the file is read
+* @param prefetchedNumber the maximal number of chunks read ahead by the producer thread; if 0, every chunk
+* is read by next() itself and no thread is started
+*/
+template<typename scalar>
+myBasicDataStream<scalar>::myBasicDataStream(std::string _path, size_t _chunkSize, size_t bufferSize, size_t prefetchedNumber)
+	: buffer(bufferSize), path(_path), inputsNumber(0), outputsNumber(0), chunkSize(_chunkSize == 0 ? 1 : _chunkSize),
+	chunks(prefetchedNumber == 0 ? 0 : prefetchedNumber + 1), current(std::string::npos), stopping(false), finished(false)
+{
+	if (extension(path) != ".set")
+		throw bad_extension(filetype::set);
+	open();
+	for (size_t c = 0; c < chunks.size(); ++c)
+		spare.push_back(c);
+}
+
+/** Opens the file and reads the header.
+*/
+template<typename scalar>
+void myBasicDataStream<scalar>::open()
+{
+	source.close();
+	source.clear();
+	source.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+	source.open(path, std::ios::in);
+	if (not source.good())
+	{
+		source.close();
+		throw no_file();
+	}
+	if (not (source >> inputsNumber >> outputsNumber))
+		throw incomplete_contents();
+	if (inputsNumber == 0 or outputsNumber == 0)
+	{
+		source.close();
+		throw incorrect_contents();
+	}
+	dataBegin = source.tellg();
+	source.seekg(0, std::ios::end);
+	dataEnd = source.tellg();
+	source.seekg(dataBegin);
+}
+
+/** Reads the next chunk of records from the file.
+* @param target the set to which the chunk shall be read; it is left empty if the file has ended
+*/
+template<typename scalar>
+void myBasicDataStream<scalar>::readChunk(myBasicDataSet<scalar>& target)
+{
+	target.clear();
+	if (not source.good())
+		return;
+	myPhaseTimer timer(phase::parsing, 0);
+	std::streampos position = source.tellg();
+	target.readRecords(source, inputsNumber, outputsNumber, chunkSize);
+	timer.addRecords(target.size());
+	timer.addBytes(uint64_t((source.good() ? source.tellg() : dataEnd) - position));
 }
+
+/** The loop of the producer thread. It fills the spare slots with the following chunks until the file
+* ends, an exception is thrown, which is passed to next(), or the thread is stopped.
+*/
+template<typename scalar>
+void myBasicDataStream<scalar>::produce()
+{
+	while (true)
+	{
+		size_t slot;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return stopping or not spare.empty(); });
+			if (stopping)
+				return;
+			slot = spare.front();
+			spare.pop_front();
+		}
+		std::exception_ptr exception;
+		try
+		{
+			readChunk(chunks[slot]);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		if (exception or chunks[slot].empty())
+		{
+			spare.push_back(slot);
+			failure = exception;
+			finished = true;
+			changed.notify_all();
+			return;
+		}
+		filled.push_back(slot);
+		changed.notify_all();
+	}
+}
+
+/** Stops the producer thread and waits for it to finish the chunk it is reading.
+*/
+template<typename scalar>
+void myBasicDataStream<scalar>::stopProducer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	if (producer.joinable())
+		producer.join();
+	stopping = false;
+}
+
+/** Returns the next chunk of records. The chunk used before is given back to the producer thread,
+* which is started at the first call after opening or rewinding.
+* @return pointer to the set holding the chunk, valid until the next call, or nullptr if the file has ended
+*/
+template<typename scalar>
+const myBasicDataSet<scalar>* myBasicDataStream<scalar>::next()
+{
+	if (chunks.empty())
+	{
+		readChunk(chunk);
+		return chunk.empty() ? nullptr : &chunk;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	if (current != std::string::npos)
+	{
+		spare.push_back(current);
+		current = std::string::npos;
+		changed.notify_all();
+	}
+	if (not producer.joinable())
+		producer = std::thread(&myBasicDataStream::produce, this);
+	changed.wait(lock, [&] { return finished or not filled.empty(); });
+	if (filled.empty())
+	{
+		if (failure)
+			std::rethrow_exception(std::exchange(failure, nullptr));
+		return nullptr;
+	}
+	current = filled.front();
+	filled.pop_front();
+	return &chunks[current];
+}
+
+/** Moves back to the first record of the file, dropping the chunks read ahead.
+*/
+template<typename scalar>
+void myBasicDataStream<scalar>::rewind()
+{
+	stopProducer();
+	filled.clear();
+	spare.clear();
+	for (size_t c = 0; c < chunks.size(); ++c)
+		spare.push_back(c);
+	current = std::string::npos;
+	finished = false;
+	failure = nullptr;
+	source.clear();
+	source.seekg(dataBegin);
+	if (not source.good())
+		open();
+}
+
+template class myBasicDataSet<float>;
+template class myBasicDataSet<double>;
+template class myBasicDataStream<float>;
+template class myBasicDataStream<double>;
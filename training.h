@@ -2,30 +2,131 @@
 
 #pragma once
 #include "network.h"
+#include <condition_variable>
+#include <deque>
 #include <exception>
+#include <fstream>
+#include <istream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 std::string extension(std::string path, char delimiter = '.');
 
-struct myDataRecord
+/** A view of a row of values stored in a data set.
+*/
+template<typename scalar>
+class myBasicRow
 {
-	std::vector<double> inputValues, targetValues;
-	myDataRecord(size_t _i, size_t _o) : inputValues(_i), targetValues(_o) {}
+	const scalar* first;
+	size_t length;
+public:
+	myBasicRow(const scalar* _first, size_t _length) : first(_first), length(_length) {}
+	const scalar* data() const { return first; }
+	size_t size() const { return length; }
+	const scalar* begin() const { return first; }
+	const scalar* end() const { return first + length; }
+	scalar operator[](size_t index) const { return first[index]; }
+};
+
+using myRow = myBasicRow<double>;
+
+/** A view of a record of a data set.
+*/
+template<typename scalar>
+struct myBasicDataRecord
+{
+	myBasicRow<scalar> inputValues, targetValues;
 };
 
-class myDataSet
+using myDataRecord = myBasicDataRecord<double>;
+
+/** A set of records. The input values of all the records are stored in one contiguous matrix,
+* one row per record, and so are the target values.
+*/
+template<typename scalar>
+class myBasicDataSet
 {
-	std::vector<myDataRecord> dataBase;
+	size_t inputsNumber, outputsNumber, recordsNumber;
+	std::vector<scalar> inputValues, targetValues;
+
+	void setSizes(size_t _inputsNumber, size_t _outputsNumber);
+
 public:
-	myDataSet() {};
-	myDataSet(std::string path) { read(path); };
+	class iterator
+	{
+		const myBasicDataSet* set;
+		size_t index;
+	public:
+		iterator(const myBasicDataSet* _set, size_t _index) : set(_set), index(_index) {}
+		myBasicDataRecord<scalar> operator*() const { return (*set)[index]; }
+		iterator& operator++() { ++index; return *this; }
+		bool operator!=(const iterator& other) const { return index != other.index; }
+	};
+
+	myBasicDataSet() : inputsNumber(0), outputsNumber(0), recordsNumber(0) {};
+	myBasicDataSet(std::string path) : myBasicDataSet() { read(path); };
 	void read(std::string path);
+	size_t readRecords(std::istream& source, size_t inputsNumber, size_t outputsNumber, size_t maxRecords);
 	void printData();
-	void clear() { dataBase.clear(); }
-	auto dataRef() const { return &dataBase; }
-	size_t size() const { return dataBase.size(); }
+	void clear() { inputValues.clear(); targetValues.clear(); recordsNumber = 0; }
+	const myBasicDataSet* dataRef() const { return this; }
+	size_t size() const { return recordsNumber; }
 	size_t inputSize() const;
 	size_t outputSize() const;
-	bool empty() const { return dataBase.empty(); }
+	bool empty() const { return recordsNumber == 0; }
+
+	const scalar* inputs(size_t record) const { return &inputValues[record * inputsNumber]; }
+	const scalar* targets(size_t record) const { return &targetValues[record * outputsNumber]; }
+	myBasicDataRecord<scalar> operator[](size_t record) const
+	{
+		return { myBasicRow<scalar>(inputs(record), inputsNumber), myBasicRow<scalar>(targets(record), outputsNumber) };
+	}
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, recordsNumber); }
 };
+
+using myDataSet = myBasicDataSet<double>;
+
+/** A set read from its file chunk by chunk. Unless it is told to read nothing ahead, a producer thread
+* reads and parses the following chunks into a bounded queue while the previous ones are used, so that
+* reading the file overlaps with the work on the records. The chunks are kept in slots reused in turn:
+* one is held by the caller of next(), the others are filled ahead or wait to be filled.
+*/
+template<typename scalar>
+class myBasicDataStream
+{
+	std::vector<char> buffer;
+	std::ifstream source;
+	std::string path;
+	std::streampos dataBegin, dataEnd;
+	size_t inputsNumber, outputsNumber, chunkSize;
+	myBasicDataSet<scalar> chunk;
+
+	std::vector<myBasicDataSet<scalar>> chunks;
+	std::deque<size_t> filled, spare;
+	size_t current;
+	bool stopping, finished;
+	std::exception_ptr failure;
+	std::thread producer;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	void open();
+	void readChunk(myBasicDataSet<scalar>& target);
+	void produce();
+	void stopProducer();
+
+public:
+	myBasicDataStream(std::string _path, size_t _chunkSize = 4096, size_t bufferSize = 1 << 20, size_t prefetchedNumber = 2);
+	~myBasicDataStream() { stopProducer(); }
+	myBasicDataStream(const myBasicDataStream&) = delete;
+	myBasicDataStream& operator=(const myBasicDataStream&) = delete;
+	const myBasicDataSet<scalar>* next();
+	void rewind();
+	size_t inputSize() const { return inputsNumber; }
+	size_t outputSize() const { return outputsNumber; }
+};
+
+using myDataStream = myBasicDataStream<double>;